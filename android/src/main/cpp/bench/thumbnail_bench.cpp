@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2018 The OpenFlutter Organization
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Times both filters of the resampler on 12 MP and 48 MP sources, both from the full image and from the
+// 2x subsampled decode the platforms hand over, down to the thumbnail sizes the solver probes.
+// fluwx_thumbnail_bench runs the SSE2/NEON kernels, fluwx_thumbnail_scalar_bench the scalar ones.
+//
+//   fluwx_thumbnail_bench [repeats]
+
+#include "fluwx_thumbnail.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+struct Buffer {
+    std::vector<uint8_t> pixels;
+    fluwx_image image;
+};
+
+void allocate(Buffer *buffer, int32_t width, int32_t height, fluwx_pixel_format format) {
+    size_t bytesPerPixel = format == FLUWX_PIXEL_RGB_565 ? 2 : 4;
+    buffer->pixels.resize(bytesPerPixel * width * height);
+    buffer->image.pixels = &buffer->pixels[0];
+    buffer->image.width = width;
+    buffer->image.height = height;
+    buffer->image.stride = bytesPerPixel * width;
+    buffer->image.format = format;
+}
+
+// a gradient with fine detail, so nothing is trivially flat.
+void fill(Buffer *buffer) {
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < buffer->pixels.size(); i++) {
+        seed = seed * 1103515245 + 12345;
+        buffer->pixels[i] = static_cast<uint8_t>((i / 4 % 251) + (seed >> 28));
+    }
+}
+
+void run(const char *name, int32_t width, int32_t height, fluwx_pixel_format format, int64_t maxBytes,
+         fluwx_filter filter, int repeats) {
+    Buffer source;
+    allocate(&source, width, height, format);
+    fill(&source);
+
+    fluwx_thumb_step step;
+    fluwx_thumb_first_step(width, height, maxBytes, FLUWX_THUMB_JPEG, &step);
+    Buffer destination;
+    allocate(&destination, step.width, step.height, format);
+
+    double best = 1e30;
+    double total = 0;
+    for (int i = 0; i < repeats; i++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (fluwx_resample(&source.image, &destination.image, filter) != FLUWX_OK) {
+            std::fprintf(stderr, "%s: resampling failed\n", name);
+            std::exit(EXIT_FAILURE);
+        }
+        double millis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        best = std::min(best, millis);
+        total += millis;
+    }
+    double megapixels = static_cast<double>(width) * height / 1e6;
+    std::printf("%-24s %-8s %5dx%-5d -> %4dx%-4d %8.2f ms best %8.2f ms mean %8.1f MP/s\n", name,
+                filter == FLUWX_FILTER_AREA ? "area" : "lanczos3", width, height, step.width, step.height,
+                best, total / repeats, megapixels / (best / 1000));
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    int repeats = argc > 1 ? std::max(1, std::atoi(argv[1])) : 5;
+    const int64_t common = 32 * 1024;
+    const int64_t miniProgram = 120 * 1024;
+
+    const fluwx_filter filters[] = {FLUWX_FILTER_AREA, FLUWX_FILTER_LANCZOS3};
+    for (size_t f = 0; f < 2; f++) {
+        run("12MP rgba -> 32K", 4000, 3000, FLUWX_PIXEL_RGBA_8888, common, filters[f], repeats);
+        run("12MP rgba /2 -> 32K", 2000, 1500, FLUWX_PIXEL_RGBA_8888, common, filters[f], repeats);
+        run("12MP rgb565 /2 -> 32K", 2000, 1500, FLUWX_PIXEL_RGB_565, common, filters[f], repeats);
+        run("12MP rgba -> 120K", 4000, 3000, FLUWX_PIXEL_RGBA_8888, miniProgram, filters[f], repeats);
+        run("48MP rgba -> 32K", 8000, 6000, FLUWX_PIXEL_RGBA_8888, common, filters[f], repeats);
+        run("48MP rgba /2 -> 32K", 4000, 3000, FLUWX_PIXEL_RGBA_8888, common, filters[f], repeats);
+        run("48MP rgb565 /2 -> 32K", 4000, 3000, FLUWX_PIXEL_RGB_565, common, filters[f], repeats);
+        run("48MP rgba -> 120K", 8000, 6000, FLUWX_PIXEL_RGBA_8888, miniProgram, filters[f], repeats);
+    }
+    return EXIT_SUCCESS;
+}
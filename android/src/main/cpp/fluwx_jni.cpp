@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2018 The OpenFlutter Organization
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// JNI side of com.jarvan.fluwx.utils.ThumbnailCore.
+
+#include <jni.h>
+#include <android/bitmap.h>
+#include <android/log.h>
+
+#include "fluwx_thumbnail.h"
+
+namespace {
+
+// layout of the int[] a step travels in, see ThumbnailCore.STEP_*.
+enum {
+    kStepWidth = 0,
+    kStepHeight = 1,
+    kStepQuality = 2,
+    kStepIndex = 3,
+    kStepSize = 4
+};
+
+bool readStep(JNIEnv *env, jintArray array, fluwx_thumb_step *step) {
+    if (env->GetArrayLength(array) < kStepSize) {
+        return false;
+    }
+    jint values[kStepSize];
+    env->GetIntArrayRegion(array, 0, kStepSize, values);
+    step->width = values[kStepWidth];
+    step->height = values[kStepHeight];
+    step->quality = values[kStepQuality];
+    step->index = values[kStepIndex];
+    return true;
+}
+
+void writeStep(JNIEnv *env, jintArray array, const fluwx_thumb_step &step) {
+    jint values[kStepSize];
+    values[kStepWidth] = step.width;
+    values[kStepHeight] = step.height;
+    values[kStepQuality] = step.quality;
+    values[kStepIndex] = step.index;
+    env->SetIntArrayRegion(array, 0, kStepSize, values);
+}
+
+bool describe(JNIEnv *env, jobject bitmap, fluwx_image *image) {
+    AndroidBitmapInfo info;
+    if (AndroidBitmap_getInfo(env, bitmap, &info) != ANDROID_BITMAP_RESULT_SUCCESS) {
+        return false;
+    }
+    if (info.format == ANDROID_BITMAP_FORMAT_RGBA_8888) {
+        image->format = FLUWX_PIXEL_RGBA_8888;
+    } else if (info.format == ANDROID_BITMAP_FORMAT_RGB_565) {
+        image->format = FLUWX_PIXEL_RGB_565;
+    } else {
+        return false;
+    }
+    image->width = static_cast<int32_t>(info.width);
+    image->height = static_cast<int32_t>(info.height);
+    image->stride = info.stride;
+    image->pixels = NULL;
+    return true;
+}
+
+}  // namespace
+
+extern "C" {
+
+JNIEXPORT jlong JNICALL
+Java_com_jarvan_fluwx_utils_ThumbnailCore_pixelCap(JNIEnv *, jclass, jlong maxBytes, jint format) {
+    return fluwx_thumb_pixel_cap(maxBytes, static_cast<fluwx_thumb_format>(format));
+}
+
+JNIEXPORT jint JNICALL
+Java_com_jarvan_fluwx_utils_ThumbnailCore_maxPixelSize(JNIEnv *, jclass, jlong maxBytes) {
+    return fluwx_thumb_max_pixel_size(maxBytes);
+}
+
+JNIEXPORT void JNICALL
+Java_com_jarvan_fluwx_utils_ThumbnailCore_firstStep(JNIEnv *env, jclass, jint sourceWidth, jint sourceHeight,
+                                                    jlong maxBytes, jint format, jintArray step) {
+    fluwx_thumb_step result;
+    fluwx_thumb_first_step(sourceWidth, sourceHeight, maxBytes, static_cast<fluwx_thumb_format>(format), &result);
+    writeStep(env, step, result);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_jarvan_fluwx_utils_ThumbnailCore_nextStep(JNIEnv *env, jclass, jint sourceWidth, jint sourceHeight,
+                                                   jlong maxBytes, jint format, jintArray step, jlong encodedLength) {
+    fluwx_thumb_step current;
+    if (!readStep(env, step, &current)) {
+        return JNI_FALSE;
+    }
+    if (!fluwx_thumb_next_step(sourceWidth, sourceHeight, maxBytes, static_cast<fluwx_thumb_format>(format),
+                               &current, encodedLength)) {
+        return JNI_FALSE;
+    }
+    writeStep(env, step, current);
+    return JNI_TRUE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_jarvan_fluwx_utils_ThumbnailCore_resample(JNIEnv *env, jclass, jobject source, jobject destination, jint filter) {
+    fluwx_image sourceImage;
+    fluwx_image destinationImage;
+    if (!describe(env, source, &sourceImage) || !describe(env, destination, &destinationImage)
+        || sourceImage.format != destinationImage.format) {
+        return JNI_FALSE;
+    }
+    if (AndroidBitmap_lockPixels(env, source, &sourceImage.pixels) != ANDROID_BITMAP_RESULT_SUCCESS) {
+        return JNI_FALSE;
+    }
+    int result = FLUWX_ERROR_ARGUMENT;
+    if (AndroidBitmap_lockPixels(env, destination, &destinationImage.pixels) == ANDROID_BITMAP_RESULT_SUCCESS) {
+        result = fluwx_resample(&sourceImage, &destinationImage, static_cast<fluwx_filter>(filter));
+        AndroidBitmap_unlockPixels(env, destination);
+    }
+    AndroidBitmap_unlockPixels(env, source);
+    if (result != FLUWX_OK) {
+        __android_log_print(ANDROID_LOG_INFO, "fluwx", "resampling bitmap failed: %d", result);
+        return JNI_FALSE;
+    }
+    return JNI_TRUE;
+}
+
+}
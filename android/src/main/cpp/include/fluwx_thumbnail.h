@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2018 The OpenFlutter Organization
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The thumbnail pipeline shared by Android and iOS: decode -> resample -> size-budgeted encode.
+ *
+ * Decoding and encoding stay with the platform codecs; this core decides the size and quality of every
+ * encode and does the resampling, so both platforms make the same decisions from the same code.
+ * Android calls it through JNI (fluwx_jni.cpp), iOS compiles these sources through ios/Classes/core.
+ */
+
+#ifndef FLUWX_THUMBNAIL_H
+#define FLUWX_THUMBNAIL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLUWX_OK 0
+#define FLUWX_ERROR_ARGUMENT (-1)
+#define FLUWX_ERROR_MEMORY (-2)
+
+typedef enum {
+    FLUWX_THUMB_JPEG = 0,
+    FLUWX_THUMB_PNG = 1
+} fluwx_thumb_format;
+
+/*
+ * one encode the caller has to do: resample the source to width x height and encode it at quality.
+ */
+typedef struct {
+    int32_t width;
+    int32_t height;
+    /* JPEG quality, 1-100; a PNG ignores it. */
+    int32_t quality;
+    /* 1 for the probe encode, 2 for the predicted one, 3 for the forced downscale. */
+    int32_t index;
+} fluwx_thumb_step;
+
+/*
+ * most pixels worth encoding for a max_bytes thumbnail of format; the solver never probes above it.
+ */
+int64_t fluwx_thumb_pixel_cap(int64_t max_bytes, fluwx_thumb_format format);
+
+/*
+ * longest edge worth decoding for a max_bytes thumbnail: the pixel cap for images up to 2:1,
+ * so the solver never has to upscale.
+ */
+int32_t fluwx_thumb_max_pixel_size(int64_t max_bytes);
+
+/*
+ * the probe encode of a source_width x source_height image: capped to the pixel cap, at the probe quality.
+ */
+void fluwx_thumb_first_step(int32_t source_width, int32_t source_height, int64_t max_bytes,
+                            fluwx_thumb_format format, fluwx_thumb_step *step);
+
+/*
+ * Given the length the encode of step came out at, returns 1 and updates step if another encode is
+ * needed, or 0 if that encode is the result. There are at most two encodes, probe and prediction, plus a
+ * third to a size at which even uncompressed pixels fit, if the prediction overshoots.
+ */
+int fluwx_thumb_next_step(int32_t source_width, int32_t source_height, int64_t max_bytes,
+                          fluwx_thumb_format format, fluwx_thumb_step *step, int64_t encoded_length);
+
+typedef enum {
+    /* 4 bytes per pixel, alpha in the fourth and premultiplied: Android's ARGB_8888, iOS's BGRA. */
+    FLUWX_PIXEL_RGBA_8888 = 0,
+    /* Android's RGB_565, one native-endian 16 bit word per pixel. */
+    FLUWX_PIXEL_RGB_565 = 1
+} fluwx_pixel_format;
+
+typedef struct {
+    void *pixels;
+    int32_t width;
+    int32_t height;
+    /* bytes from one row to the next. */
+    size_t stride;
+    fluwx_pixel_format format;
+} fluwx_image;
+
+typedef enum {
+    /* every output pixel is the average of the source pixels it covers; cheap and alias-free at any ratio. */
+    FLUWX_FILTER_AREA = 0,
+    /* Lanczos3 widened by the ratio: sharper than area, at about twice the taps. */
+    FLUWX_FILTER_LANCZOS3 = 1
+} fluwx_filter;
+
+/*
+ * resamples source into destination, which has the same format, in a single pass whatever the ratio.
+ * Vectorized with SSE2 or NEON where the target has them. Returns FLUWX_OK or a FLUWX_ERROR_ code.
+ */
+int fluwx_resample(const fluwx_image *source, const fluwx_image *destination, fluwx_filter filter);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FLUWX_THUMBNAIL_H */
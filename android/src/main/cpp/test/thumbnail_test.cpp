@@ -0,0 +1,396 @@
+/*
+ * Copyright (C) 2018 The OpenFlutter Organization
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fluwx_thumbnail.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+const int64_t kCommonThumbLength = 32 * 1024;
+const int64_t kMiniProgramThumbLength = 120 * 1024;
+
+// stands in for a platform encoder: bytes grow with pixels and fall with quality like a JPEG's do,
+// scaled by how busy the image is, and never exceed the uncompressed size.
+int64_t modelLength(const fluwx_thumb_step &step, fluwx_thumb_format format, double busyness) {
+    double pixels = static_cast<double>(step.width) * step.height;
+    double bitsPerPixel;
+    if (format == FLUWX_THUMB_PNG) {
+        bitsPerPixel = std::min(33.0, 8.0 * busyness);
+    } else {
+        double qualityFactor = 0.41 + (step.quality - 40) * (1.0 - 0.41) / 45.0;
+        bitsPerPixel = std::min(24.0, 2.0 * busyness * qualityFactor);
+    }
+    return static_cast<int64_t>(pixels * bitsPerPixel / 8);
+}
+
+struct Run {
+    fluwx_thumb_step step;
+    int encodes;
+    int64_t length;
+};
+
+Run solve(int32_t width, int32_t height, int64_t maxBytes, fluwx_thumb_format format, double busyness) {
+    Run run;
+    fluwx_thumb_first_step(width, height, maxBytes, format, &run.step);
+    run.encodes = 0;
+    do {
+        run.length = modelLength(run.step, format, busyness);
+        run.encodes++;
+    } while (fluwx_thumb_next_step(width, height, maxBytes, format, &run.step, run.length));
+    return run;
+}
+
+void testPixelCap() {
+    CHECK(fluwx_thumb_pixel_cap(kCommonThumbLength, FLUWX_THUMB_JPEG) == 131072);
+    CHECK(fluwx_thumb_pixel_cap(kCommonThumbLength, FLUWX_THUMB_PNG) == 32768);
+    CHECK(fluwx_thumb_max_pixel_size(kCommonThumbLength) == 512);
+
+    fluwx_thumb_step step;
+    fluwx_thumb_first_step(4000, 3000, kCommonThumbLength, FLUWX_THUMB_JPEG, &step);
+    CHECK(static_cast<int64_t>(step.width) * step.height <= 131072);
+    CHECK(std::abs(static_cast<double>(step.width) / step.height - 4.0 / 3) < 0.01);
+    CHECK(step.quality == 85);
+    CHECK(step.index == 1);
+
+    // a small source is probed as is, never upscaled.
+    fluwx_thumb_first_step(200, 100, kCommonThumbLength, FLUWX_THUMB_JPEG, &step);
+    CHECK(step.width == 200 && step.height == 100);
+
+    // the longest edge worth decoding covers the pixel cap up to 2:1.
+    int32_t edge = fluwx_thumb_max_pixel_size(kMiniProgramThumbLength);
+    fluwx_thumb_first_step(edge, edge / 2, kMiniProgramThumbLength, FLUWX_THUMB_JPEG, &step);
+    CHECK(step.width >= edge - 1);
+}
+
+void testNextStep() {
+    fluwx_thumb_step step;
+    fluwx_thumb_first_step(4000, 3000, kCommonThumbLength, FLUWX_THUMB_JPEG, &step);
+    fluwx_thumb_step probe = step;
+
+    // fits: the probe is the result.
+    CHECK(!fluwx_thumb_next_step(4000, 3000, kCommonThumbLength, FLUWX_THUMB_JPEG, &step, kCommonThumbLength));
+
+    // 30% over: a lower quality alone gets there, the size stays.
+    step = probe;
+    CHECK(fluwx_thumb_next_step(4000, 3000, kCommonThumbLength, FLUWX_THUMB_JPEG, &step, kCommonThumbLength * 13 / 10));
+    CHECK(step.index == 2);
+    CHECK(step.quality == 70);
+    CHECK(step.width == probe.width && step.height == probe.height);
+
+    // far over: the lowest quality and fewer pixels.
+    step = probe;
+    CHECK(fluwx_thumb_next_step(4000, 3000, kCommonThumbLength, FLUWX_THUMB_JPEG, &step, kCommonThumbLength * 4));
+    CHECK(step.quality == 40);
+    CHECK(step.width < probe.width && step.height < probe.height);
+
+    // PNG has no quality to trade, only pixels.
+    fluwx_thumb_first_step(1000, 1000, kCommonThumbLength, FLUWX_THUMB_PNG, &step);
+    probe = step;
+    CHECK(fluwx_thumb_next_step(1000, 1000, kCommonThumbLength, FLUWX_THUMB_PNG, &step, kCommonThumbLength * 2));
+    CHECK(step.width < probe.width);
+
+    // the forced downscale fits even uncompressed pixels, and it is the last step.
+    step.index = 2;
+    CHECK(fluwx_thumb_next_step(1000, 1000, kCommonThumbLength, FLUWX_THUMB_PNG, &step, kCommonThumbLength * 2));
+    CHECK(step.index == 3);
+    CHECK(static_cast<double>(step.width) * step.height * 33 / 8 <= kCommonThumbLength);
+    CHECK(!fluwx_thumb_next_step(1000, 1000, kCommonThumbLength, FLUWX_THUMB_PNG, &step, kCommonThumbLength * 2));
+}
+
+void testSolveConverges() {
+    const int32_t sizes[][2] = {{4000, 3000}, {8000, 6000}, {3000, 4000}, {10000, 1000}, {640, 480}, {64, 64}};
+    const double busyness[] = {0.3, 1.0, 2.0, 5.0, 40.0};
+    const int64_t budgets[] = {kCommonThumbLength, kMiniProgramThumbLength};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        for (size_t b = 0; b < sizeof(busyness) / sizeof(busyness[0]); b++) {
+            for (size_t m = 0; m < sizeof(budgets) / sizeof(budgets[0]); m++) {
+                for (int png = 0; png < 2; png++) {
+                    fluwx_thumb_format format = png ? FLUWX_THUMB_PNG : FLUWX_THUMB_JPEG;
+                    Run run = solve(sizes[s][0], sizes[s][1], budgets[m], format, busyness[b]);
+                    CHECK(run.encodes <= 3);
+                    CHECK(run.length <= budgets[m]);
+                    CHECK(run.step.width >= 1 && run.step.height >= 1);
+                }
+            }
+        }
+    }
+
+    // an ordinary photo takes at most the probe and the prediction.
+    CHECK(solve(4000, 3000, kCommonThumbLength, FLUWX_THUMB_JPEG, 1.0).encodes <= 2);
+    CHECK(solve(4000, 3000, kCommonThumbLength, FLUWX_THUMB_JPEG, 2.0).encodes <= 2);
+}
+
+fluwx_image imageOf(std::vector<uint8_t> &pixels, int32_t width, int32_t height, fluwx_pixel_format format) {
+    size_t bytesPerPixel = format == FLUWX_PIXEL_RGB_565 ? 2 : 4;
+    pixels.assign(bytesPerPixel * width * height, 0);
+    fluwx_image image;
+    image.pixels = &pixels[0];
+    image.width = width;
+    image.height = height;
+    image.stride = bytesPerPixel * width;
+    image.format = format;
+    return image;
+}
+
+void testResampleFlat() {
+    const fluwx_filter filters[] = {FLUWX_FILTER_AREA, FLUWX_FILTER_LANCZOS3};
+    for (size_t f = 0; f < 2; f++) {
+        std::vector<uint8_t> sourcePixels;
+        std::vector<uint8_t> destinationPixels;
+        fluwx_image source = imageOf(sourcePixels, 1001, 777, FLUWX_PIXEL_RGBA_8888);
+        for (size_t i = 0; i < sourcePixels.size(); i += 4) {
+            sourcePixels[i] = 10;
+            sourcePixels[i + 1] = 128;
+            sourcePixels[i + 2] = 250;
+            sourcePixels[i + 3] = 255;
+        }
+        fluwx_image destination = imageOf(destinationPixels, 97, 61, FLUWX_PIXEL_RGBA_8888);
+        CHECK(fluwx_resample(&source, &destination, filters[f]) == FLUWX_OK);
+        bool flat = true;
+        for (size_t i = 0; i < destinationPixels.size(); i += 4) {
+            flat = flat && destinationPixels[i] == 10 && destinationPixels[i + 1] == 128
+                   && destinationPixels[i + 2] == 250 && destinationPixels[i + 3] == 255;
+        }
+        CHECK(flat);
+    }
+}
+
+double referenceLanczos3(double x) {
+    x = std::fabs(x);
+    if (x < 1e-9) {
+        return 1;
+    }
+    if (x >= 3) {
+        return 0;
+    }
+    double px = 3.14159265358979323846 * x;
+    return 3 * std::sin(px) * std::sin(px / 3) / (px * px);
+}
+
+// weights of one axis in plain floating point, straight from the definition of each filter.
+std::vector<std::vector<double> > referenceWeights(int32_t sourceLength, int32_t destinationLength, fluwx_filter filter) {
+    double scale = static_cast<double>(sourceLength) / destinationLength;
+    std::vector<std::vector<double> > weights(destinationLength, std::vector<double>(sourceLength, 0.0));
+    for (int32_t i = 0; i < destinationLength; i++) {
+        double total = 0;
+        for (int32_t j = 0; j < sourceLength; j++) {
+            double weight;
+            if (filter == FLUWX_FILTER_AREA) {
+                weight = std::max(0.0, std::min<double>(j + 1, (i + 1) * scale) - std::max<double>(j, i * scale));
+            } else {
+                double filterScale = std::max(scale, 1.0);
+                weight = referenceLanczos3((j + 0.5 - (i + 0.5) * scale) / filterScale);
+            }
+            weights[i][j] = weight;
+            total += weight;
+        }
+        for (int32_t j = 0; j < sourceLength; j++) {
+            weights[i][j] /= total;
+        }
+    }
+    return weights;
+}
+
+// the kernels, vectorized or not, against floating point on noisy premultiplied pixels of awkward sizes.
+void testResampleMatchesReference() {
+    const int32_t sizes[][4] = {{37, 23, 5, 4}, {640, 480, 213, 160}, {101, 77, 100, 76}, {9, 9, 4, 7}, {300, 17, 41, 3}, {3, 40, 2, 9}};
+    const fluwx_filter filters[] = {FLUWX_FILTER_AREA, FLUWX_FILTER_LANCZOS3};
+    uint32_t seed = 1;
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        std::vector<uint8_t> sourcePixels;
+        fluwx_image source = imageOf(sourcePixels, sizes[s][0], sizes[s][1], FLUWX_PIXEL_RGBA_8888);
+        for (size_t i = 0; i < sourcePixels.size(); i += 4) {
+            seed = seed * 1103515245 + 12345;
+            uint8_t alpha = (seed >> 24) < 64 ? 0 : static_cast<uint8_t>(seed >> 16);
+            for (int c = 0; c < 3; c++) {
+                seed = seed * 1103515245 + 12345;
+                sourcePixels[i + c] = static_cast<uint8_t>((seed >> 16) % (alpha + 1));
+            }
+            sourcePixels[i + 3] = alpha;
+        }
+
+        for (size_t f = 0; f < 2; f++) {
+            std::vector<uint8_t> destinationPixels;
+            fluwx_image destination = imageOf(destinationPixels, sizes[s][2], sizes[s][3], FLUWX_PIXEL_RGBA_8888);
+            CHECK(fluwx_resample(&source, &destination, filters[f]) == FLUWX_OK);
+
+            std::vector<std::vector<double> > horizontal = referenceWeights(source.width, destination.width, filters[f]);
+            std::vector<std::vector<double> > vertical = referenceWeights(source.height, destination.height, filters[f]);
+            // rows first, then columns; in floating point the order doesn't change the result.
+            std::vector<double> rows(static_cast<size_t>(source.height) * destination.width * 4, 0.0);
+            for (int32_t sy = 0; sy < source.height; sy++) {
+                for (int32_t x = 0; x < destination.width; x++) {
+                    for (int32_t sx = 0; sx < source.width; sx++) {
+                        for (int c = 0; c < 4; c++) {
+                            rows[(sy * destination.width + x) * 4 + c] += horizontal[x][sx] * sourcePixels[(sy * source.width + sx) * 4 + c];
+                        }
+                    }
+                }
+            }
+            int worst = 0;
+            for (int32_t y = 0; y < destination.height; y++) {
+                for (int32_t x = 0; x < destination.width; x++) {
+                    double values[4] = {0, 0, 0, 0};
+                    for (int32_t sy = 0; sy < source.height; sy++) {
+                        for (int c = 0; c < 4; c++) {
+                            values[c] += vertical[y][sy] * rows[(sy * destination.width + x) * 4 + c];
+                        }
+                    }
+                    double alpha = std::min(255.0, std::max(0.0, values[3]));
+                    for (int c = 0; c < 4; c++) {
+                        double expected = std::min(alpha, std::min(255.0, std::max(0.0, values[c])));
+                        int actual = destinationPixels[(y * destination.width + x) * 4 + c];
+                        worst = std::max(worst, static_cast<int>(std::ceil(std::fabs(actual - expected) - 0.5)));
+                        CHECK(c == 3 || actual <= destinationPixels[(y * destination.width + x) * 4 + 3]);
+                    }
+                }
+            }
+            CHECK(worst <= 1);
+        }
+    }
+}
+
+void testResampleAverages() {
+    std::vector<uint8_t> sourcePixels;
+    std::vector<uint8_t> destinationPixels;
+    // a 2x2 checkerboard of 0 and 200 becomes one pixel of 100.
+    fluwx_image source = imageOf(sourcePixels, 4, 4, FLUWX_PIXEL_RGBA_8888);
+    for (int32_t y = 0; y < 4; y++) {
+        for (int32_t x = 0; x < 4; x++) {
+            uint8_t value = (x + y) % 2 ? 200 : 0;
+            for (int c = 0; c < 4; c++) {
+                sourcePixels[(y * 4 + x) * 4 + c] = value;
+            }
+        }
+    }
+    fluwx_image destination = imageOf(destinationPixels, 2, 2, FLUWX_PIXEL_RGBA_8888);
+    CHECK(fluwx_resample(&source, &destination, FLUWX_FILTER_AREA) == FLUWX_OK);
+    for (size_t i = 0; i < destinationPixels.size(); i++) {
+        CHECK(destinationPixels[i] == 100);
+    }
+
+    // 3 -> 2 weighs by coverage: (2a + b) / 3 and (b + 2c) / 3.
+    source = imageOf(sourcePixels, 3, 1, FLUWX_PIXEL_RGBA_8888);
+    const uint8_t values[] = {0, 90, 240};
+    for (int x = 0; x < 3; x++) {
+        for (int c = 0; c < 4; c++) {
+            sourcePixels[x * 4 + c] = values[x];
+        }
+    }
+    destination = imageOf(destinationPixels, 2, 1, FLUWX_PIXEL_RGBA_8888);
+    CHECK(fluwx_resample(&source, &destination, FLUWX_FILTER_AREA) == FLUWX_OK);
+    CHECK(destinationPixels[0] == 30);
+    CHECK(destinationPixels[4] == 190);
+}
+
+void testResampleRgb565() {
+    std::vector<uint8_t> sourcePixels;
+    std::vector<uint8_t> destinationPixels;
+    fluwx_image source = imageOf(sourcePixels, 300, 200, FLUWX_PIXEL_RGB_565);
+    const uint16_t color = static_cast<uint16_t>((21 << 11) | (40 << 5) | 9);
+    uint16_t *words = reinterpret_cast<uint16_t *>(&sourcePixels[0]);
+    for (size_t i = 0; i < sourcePixels.size() / 2; i++) {
+        words[i] = color;
+    }
+    fluwx_image destination = imageOf(destinationPixels, 71, 45, FLUWX_PIXEL_RGB_565);
+    CHECK(fluwx_resample(&source, &destination, FLUWX_FILTER_AREA) == FLUWX_OK);
+    const uint16_t *result = reinterpret_cast<const uint16_t *>(&destinationPixels[0]);
+    bool flat = true;
+    for (size_t i = 0; i < destinationPixels.size() / 2; i++) {
+        flat = flat && result[i] == color;
+    }
+    CHECK(flat);
+}
+
+void testResampleStrideAndCopy() {
+    // rows padded past the width are neither read nor written.
+    std::vector<uint8_t> sourcePixels(16 * 8, 77);
+    fluwx_image source = {&sourcePixels[0], 3, 8, 16, FLUWX_PIXEL_RGBA_8888};
+    std::vector<uint8_t> destinationPixels(16 * 8, 1);
+    fluwx_image destination = {&destinationPixels[0], 3, 8, 16, FLUWX_PIXEL_RGBA_8888};
+    CHECK(fluwx_resample(&source, &destination, FLUWX_FILTER_AREA) == FLUWX_OK);
+    CHECK(destinationPixels[11] == 77);
+    CHECK(destinationPixels[12] == 1);
+
+    destination.width = 2;
+    destination.height = 3;
+    CHECK(fluwx_resample(&source, &destination, FLUWX_FILTER_AREA) == FLUWX_OK);
+    CHECK(destinationPixels[0] == 77 && destinationPixels[7] == 77 && destinationPixels[8] == 77);
+}
+
+void testResampleUpscale() {
+    std::vector<uint8_t> sourcePixels;
+    std::vector<uint8_t> destinationPixels;
+    fluwx_image source = imageOf(sourcePixels, 2, 2, FLUWX_PIXEL_RGBA_8888);
+    for (size_t i = 0; i < sourcePixels.size(); i++) {
+        sourcePixels[i] = static_cast<uint8_t>(i * 10);
+    }
+    fluwx_image destination = imageOf(destinationPixels, 5, 3, FLUWX_PIXEL_RGBA_8888);
+    CHECK(fluwx_resample(&source, &destination, FLUWX_FILTER_AREA) == FLUWX_OK);
+    CHECK(destinationPixels[0] == sourcePixels[0]);
+}
+
+void testResampleRejectsBadArguments() {
+    std::vector<uint8_t> sourcePixels;
+    std::vector<uint8_t> destinationPixels;
+    fluwx_image source = imageOf(sourcePixels, 4, 4, FLUWX_PIXEL_RGBA_8888);
+    fluwx_image destination = imageOf(destinationPixels, 2, 2, FLUWX_PIXEL_RGB_565);
+    CHECK(fluwx_resample(&source, &destination, FLUWX_FILTER_AREA) == FLUWX_ERROR_ARGUMENT);
+    CHECK(fluwx_resample(NULL, &destination, FLUWX_FILTER_AREA) == FLUWX_ERROR_ARGUMENT);
+    destination = imageOf(destinationPixels, 2, 2, FLUWX_PIXEL_RGBA_8888);
+    destination.stride = 4;
+    CHECK(fluwx_resample(&source, &destination, FLUWX_FILTER_AREA) == FLUWX_ERROR_ARGUMENT);
+    destination.stride = 8;
+    CHECK(fluwx_resample(&source, &destination, static_cast<fluwx_filter>(7)) == FLUWX_ERROR_ARGUMENT);
+    destination.height = 0;
+    CHECK(fluwx_resample(&source, &destination, FLUWX_FILTER_AREA) == FLUWX_ERROR_ARGUMENT);
+}
+
+}  // namespace
+
+int main() {
+    testPixelCap();
+    testNextStep();
+    testSolveConverges();
+    testResampleFlat();
+    testResampleMatchesReference();
+    testResampleAverages();
+    testResampleRgb565();
+    testResampleStrideAndCopy();
+    testResampleUpscale();
+    testResampleRejectsBadArguments();
+    if (failures > 0) {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    std::printf("all checks passed\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,411 @@
+/*
+ * Copyright (C) 2018 The OpenFlutter Organization
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fluwx_thumbnail.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#if !defined(FLUWX_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#define FLUWX_SSE2 1
+#include <emmintrin.h>
+#elif !defined(FLUWX_NO_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define FLUWX_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Separable fixed-point resampling: every source row is filtered horizontally once into a small ring of
+// rows, and every output row is a weighted sum of the ring rows it covers, so memory stays at a few
+// output rows whatever the size of the source.
+//
+// Pixels are filtered as 4 channels of 16 bit; RGB_565 is unpacked to that and packed back. The kernels
+// have SSE2 (every x86 Android ABI, the simulator) and NEON (arm64, armeabi-v7a) versions, which give
+// the same results as the scalar ones; FLUWX_NO_SIMD builds only the scalar ones.
+
+namespace {
+
+// weights are fixed point with this many fractional bits and sum to exactly 1 << kWeightBits.
+const int kWeightBits = 14;
+
+// horizontally filtered values keep this many fractional bits, which leaves int16 room for the
+// overshoot of Lanczos.
+const int kRowBits = 6;
+
+const int kColumnShift = kWeightBits + kRowBits;
+
+const int kChannels = 4;
+
+// the taps of one axis: output i sums taps weights from source index start[i] on, padded with zero
+// weights so that every output has the same, even if possible, number of taps and never reads past the source.
+struct Axis {
+    int taps;
+    std::vector<int32_t> start;
+    std::vector<int16_t> weights;
+};
+
+double lanczos3(double x) {
+    x = std::fabs(x);
+    if (x < 1e-9) {
+        return 1;
+    }
+    if (x >= 3) {
+        return 0;
+    }
+    const double pi = 3.14159265358979323846;
+    double px = pi * x;
+    return 3 * std::sin(px) * std::sin(px / 3) / (px * px);
+}
+
+// the source pixels output i covers and how much each of them counts.
+void areaSpan(int32_t sourceLength, double scale, int32_t i, int32_t *first, std::vector<double> *span) {
+    double low = i * scale;
+    double high = std::min<double>((i + 1) * scale, sourceLength);
+    *first = static_cast<int32_t>(std::floor(low));
+    int32_t last = std::min<int32_t>(sourceLength, static_cast<int32_t>(std::ceil(high)));
+    for (int32_t j = *first; j < last; j++) {
+        double overlap = std::min<double>(j + 1, high) - std::max<double>(j, low);
+        if (overlap > 1e-9 || j == *first) {
+            span->push_back(std::max(0.0, overlap));
+        }
+    }
+}
+
+// Lanczos3 centered on output i, stretched by the scale when downscaling so that it still low-passes.
+void lanczosSpan(int32_t sourceLength, double scale, int32_t i, int32_t *first, std::vector<double> *span) {
+    double filterScale = std::max(scale, 1.0);
+    double support = 3 * filterScale;
+    double center = (i + 0.5) * scale;
+    *first = std::max<int32_t>(0, static_cast<int32_t>(std::floor(center - support)));
+    int32_t last = std::min<int32_t>(sourceLength, static_cast<int32_t>(std::ceil(center + support)));
+    for (int32_t j = *first; j < last; j++) {
+        span->push_back(lanczos3((j + 0.5 - center) / filterScale));
+    }
+}
+
+void computeAxis(fluwx_filter filter, int32_t sourceLength, int32_t destinationLength, Axis *axis) {
+    double scale = static_cast<double>(sourceLength) / destinationLength;
+    std::vector<std::vector<double> > spans(destinationLength);
+    axis->start.assign(destinationLength, 0);
+    axis->taps = 1;
+    for (int32_t i = 0; i < destinationLength; i++) {
+        if (filter == FLUWX_FILTER_LANCZOS3) {
+            lanczosSpan(sourceLength, scale, i, &axis->start[i], &spans[i]);
+        } else {
+            areaSpan(sourceLength, scale, i, &axis->start[i], &spans[i]);
+        }
+        axis->taps = std::max<int>(axis->taps, static_cast<int>(spans[i].size()));
+    }
+    // the vector kernels take taps in pairs.
+    if (axis->taps % 2 != 0 && axis->taps < sourceLength) {
+        axis->taps++;
+    }
+
+    axis->weights.assign(static_cast<size_t>(destinationLength) * axis->taps, 0);
+    for (int32_t i = 0; i < destinationLength; i++) {
+        // shift the window back at the end of the source, the weights move up and zeros fill in front.
+        int32_t start = std::min(axis->start[i], sourceLength - axis->taps);
+        int offset = axis->start[i] - start;
+        axis->start[i] = start;
+
+        int16_t *weights = &axis->weights[static_cast<size_t>(i) * axis->taps];
+        double total = 0;
+        for (size_t k = 0; k < spans[i].size(); k++) {
+            total += spans[i][k];
+        }
+        int sum = 0;
+        int largest = offset;
+        for (size_t k = 0; k < spans[i].size(); k++) {
+            int weight = static_cast<int>(std::lround(spans[i][k] / total * (1 << kWeightBits)));
+            weights[offset + k] = static_cast<int16_t>(weight);
+            sum += weight;
+            if (weight > weights[largest]) {
+                largest = static_cast<int>(offset + k);
+            }
+        }
+        // rounding error goes to the largest weight, so a flat image stays flat.
+        weights[largest] = static_cast<int16_t>(weights[largest] + (1 << kWeightBits) - sum);
+    }
+}
+
+// values [begin, end) of an output row; with clampAlpha, color channels don't exceed the alpha that
+// follows them, which Lanczos' ringing could break for premultiplied pixels.
+void filterColumnScalar(const int16_t *const *rows, const int16_t *weights, int taps, size_t begin, size_t end,
+                        bool clampAlpha, uint8_t *out) {
+    for (size_t i = begin; i < end; i += kChannels) {
+        int32_t values[kChannels];
+        for (int c = 0; c < kChannels; c++) {
+            int32_t sum = 1 << (kColumnShift - 1);
+            for (int k = 0; k < taps; k++) {
+                sum += weights[k] * rows[k][i + c];
+            }
+            sum >>= kColumnShift;
+            values[c] = sum < 0 ? 0 : (sum > 255 ? 255 : sum);
+        }
+        for (int c = 0; c < kChannels; c++) {
+            out[i + c] = static_cast<uint8_t>(clampAlpha ? std::min(values[c], values[kChannels - 1]) : values[c]);
+        }
+    }
+}
+
+#if FLUWX_SSE2
+
+// two int16 weights in every int32 lane, for _mm_madd_epi16 against interleaved pairs.
+inline __m128i weightPair(int16_t first, int16_t second) {
+    return _mm_set1_epi32(static_cast<int>((static_cast<uint32_t>(static_cast<uint16_t>(second)) << 16)
+                                           | static_cast<uint16_t>(first)));
+}
+
+void filterRow(const uint8_t *source, const Axis &axis, int32_t destinationWidth, int16_t *out) {
+    const int taps = axis.taps;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rounding = _mm_set1_epi32(1 << (kWeightBits - kRowBits - 1));
+    for (int32_t x = 0; x < destinationWidth; x++) {
+        const uint8_t *pixel = source + axis.start[x] * kChannels;
+        const int16_t *weights = &axis.weights[static_cast<size_t>(x) * taps];
+        __m128i sum = rounding;
+        int k = 0;
+        for (; k + 1 < taps; k += 2) {
+            // two pixels, interleaved channel by channel: r0 r1 g0 g1 b0 b1 a0 a1.
+            __m128i pair = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(pixel + k * kChannels)), zero);
+            pair = _mm_unpacklo_epi16(pair, _mm_srli_si128(pair, 8));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(pair, weightPair(weights[k], weights[k + 1])));
+        }
+        if (k < taps) {
+            int32_t last;
+            std::memcpy(&last, pixel + k * kChannels, sizeof(last));
+            __m128i single = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(last), zero), zero);
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(single, weightPair(weights[k], 0)));
+        }
+        sum = _mm_srai_epi32(sum, kWeightBits - kRowBits);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(out + x * kChannels), _mm_packs_epi32(sum, sum));
+    }
+}
+
+void filterColumn(const int16_t *const *rows, const int16_t *weights, int taps, size_t count, bool clampAlpha, uint8_t *out) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rounding = _mm_set1_epi32(1 << (kColumnShift - 1));
+    const __m128i max = _mm_set1_epi16(255);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i low = rounding;
+        __m128i high = rounding;
+        int k = 0;
+        for (; k + 1 < taps; k += 2) {
+            __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows[k] + i));
+            __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows[k + 1] + i));
+            __m128i pair = weightPair(weights[k], weights[k + 1]);
+            low = _mm_add_epi32(low, _mm_madd_epi16(_mm_unpacklo_epi16(first, second), pair));
+            high = _mm_add_epi32(high, _mm_madd_epi16(_mm_unpackhi_epi16(first, second), pair));
+        }
+        if (k < taps) {
+            __m128i last = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows[k] + i));
+            __m128i pair = weightPair(weights[k], 0);
+            low = _mm_add_epi32(low, _mm_madd_epi16(_mm_unpacklo_epi16(last, zero), pair));
+            high = _mm_add_epi32(high, _mm_madd_epi16(_mm_unpackhi_epi16(last, zero), pair));
+        }
+        __m128i values = _mm_packs_epi32(_mm_srai_epi32(low, kColumnShift), _mm_srai_epi32(high, kColumnShift));
+        values = _mm_min_epi16(_mm_max_epi16(values, zero), max);
+        if (clampAlpha) {
+            __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(values, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+            values = _mm_min_epi16(values, alpha);
+        }
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(out + i), _mm_packus_epi16(values, values));
+    }
+    filterColumnScalar(rows, weights, taps, i, count, clampAlpha, out);
+}
+
+#elif FLUWX_NEON
+
+void filterRow(const uint8_t *source, const Axis &axis, int32_t destinationWidth, int16_t *out) {
+    const int taps = axis.taps;
+    const int32x4_t rounding = vdupq_n_s32(1 << (kWeightBits - kRowBits - 1));
+    for (int32_t x = 0; x < destinationWidth; x++) {
+        const uint8_t *pixel = source + axis.start[x] * kChannels;
+        const int16_t *weights = &axis.weights[static_cast<size_t>(x) * taps];
+        int32x4_t sum = rounding;
+        int k = 0;
+        for (; k + 1 < taps; k += 2) {
+            int16x8_t pair = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(pixel + k * kChannels)));
+            sum = vmlal_n_s16(sum, vget_low_s16(pair), weights[k]);
+            sum = vmlal_n_s16(sum, vget_high_s16(pair), weights[k + 1]);
+        }
+        if (k < taps) {
+            uint32_t last;
+            std::memcpy(&last, pixel + k * kChannels, sizeof(last));
+            int16x8_t single = vreinterpretq_s16_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(last))));
+            sum = vmlal_n_s16(sum, vget_low_s16(single), weights[k]);
+        }
+        vst1_s16(out + x * kChannels, vmovn_s32(vshrq_n_s32(sum, kWeightBits - kRowBits)));
+    }
+}
+
+void filterColumn(const int16_t *const *rows, const int16_t *weights, int taps, size_t count, bool clampAlpha, uint8_t *out) {
+    const int32x4_t rounding = vdupq_n_s32(1 << (kColumnShift - 1));
+    const int16x8_t zero = vdupq_n_s16(0);
+    const int16x8_t max = vdupq_n_s16(255);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        int32x4_t low = rounding;
+        int32x4_t high = rounding;
+        for (int k = 0; k < taps; k++) {
+            int16x8_t row = vld1q_s16(rows[k] + i);
+            low = vmlal_n_s16(low, vget_low_s16(row), weights[k]);
+            high = vmlal_n_s16(high, vget_high_s16(row), weights[k]);
+        }
+        int16x8_t values = vcombine_s16(vqmovn_s32(vshrq_n_s32(low, kColumnShift)), vqmovn_s32(vshrq_n_s32(high, kColumnShift)));
+        values = vminq_s16(vmaxq_s16(values, zero), max);
+        if (clampAlpha) {
+            int16x8_t alpha = vcombine_s16(vdup_lane_s16(vget_low_s16(values), 3), vdup_lane_s16(vget_high_s16(values), 3));
+            values = vminq_s16(values, alpha);
+        }
+        vst1_u8(out + i, vqmovun_s16(values));
+    }
+    filterColumnScalar(rows, weights, taps, i, count, clampAlpha, out);
+}
+
+#else
+
+void filterRow(const uint8_t *source, const Axis &axis, int32_t destinationWidth, int16_t *out) {
+    const int taps = axis.taps;
+    for (int32_t x = 0; x < destinationWidth; x++) {
+        const uint8_t *pixel = source + axis.start[x] * kChannels;
+        const int16_t *weights = &axis.weights[static_cast<size_t>(x) * taps];
+        int32_t sums[kChannels] = {0, 0, 0, 0};
+        for (int k = 0; k < taps; k++) {
+            for (int c = 0; c < kChannels; c++) {
+                sums[c] += weights[k] * pixel[k * kChannels + c];
+            }
+        }
+        for (int c = 0; c < kChannels; c++) {
+            out[x * kChannels + c] = static_cast<int16_t>((sums[c] + (1 << (kWeightBits - kRowBits - 1))) >> (kWeightBits - kRowBits));
+        }
+    }
+}
+
+
+void filterColumn(const int16_t *const *rows, const int16_t *weights, int taps, size_t count, bool clampAlpha, uint8_t *out) {
+    filterColumnScalar(rows, weights, taps, 0, count, clampAlpha, out);
+}
+
+#endif
+
+void unpack565(const uint16_t *source, int32_t width, uint8_t *out) {
+    for (int32_t x = 0; x < width; x++) {
+        uint16_t pixel = source[x];
+        uint8_t r = static_cast<uint8_t>(pixel >> 11);
+        uint8_t g = static_cast<uint8_t>((pixel >> 5) & 0x3f);
+        uint8_t b = static_cast<uint8_t>(pixel & 0x1f);
+        out[x * kChannels] = static_cast<uint8_t>((r << 3) | (r >> 2));
+        out[x * kChannels + 1] = static_cast<uint8_t>((g << 2) | (g >> 4));
+        out[x * kChannels + 2] = static_cast<uint8_t>((b << 3) | (b >> 2));
+        out[x * kChannels + 3] = 255;
+    }
+}
+
+void pack565(const uint8_t *source, int32_t width, uint16_t *out) {
+    for (int32_t x = 0; x < width; x++) {
+        const uint8_t *pixel = source + x * kChannels;
+        out[x] = static_cast<uint16_t>(((pixel[0] >> 3) << 11) | ((pixel[1] >> 2) << 5) | (pixel[2] >> 3));
+    }
+}
+
+const uint8_t *rowOf(const fluwx_image *image, int32_t y) {
+    return static_cast<const uint8_t *>(image->pixels) + image->stride * y;
+}
+
+uint8_t *mutableRowOf(const fluwx_image *image, int32_t y) {
+    return static_cast<uint8_t *>(image->pixels) + image->stride * y;
+}
+
+bool isValid(const fluwx_image *image) {
+    if (image == NULL || image->pixels == NULL || image->width <= 0 || image->height <= 0) {
+        return false;
+    }
+    size_t bytesPerPixel = image->format == FLUWX_PIXEL_RGB_565 ? 2 : 4;
+    return image->stride >= image->width * bytesPerPixel;
+}
+
+void resample(const fluwx_image *source, const fluwx_image *destination, fluwx_filter filter) {
+    const bool rgb565 = source->format == FLUWX_PIXEL_RGB_565;
+    // area weights are never negative, so only Lanczos can push a premultiplied color past its alpha.
+    const bool clampAlpha = !rgb565 && filter == FLUWX_FILTER_LANCZOS3;
+
+    Axis horizontal;
+    Axis vertical;
+    computeAxis(filter, source->width, destination->width, &horizontal);
+    computeAxis(filter, source->height, destination->height, &vertical);
+
+    // ring of filtered rows, tagged with the source row they hold; output rows need ascending source
+    // rows, so one slot per vertical tap is enough.
+    const size_t rowLength = static_cast<size_t>(destination->width) * kChannels;
+    std::vector<int16_t> ring(rowLength * vertical.taps);
+    std::vector<int32_t> ringRows(vertical.taps, -1);
+    std::vector<const int16_t *> taps(vertical.taps);
+    std::vector<uint8_t> unpacked(rgb565 ? static_cast<size_t>(source->width) * kChannels : 0);
+    std::vector<uint8_t> packed(rgb565 ? rowLength : 0);
+
+    for (int32_t y = 0; y < destination->height; y++) {
+        int32_t start = vertical.start[y];
+        for (int k = 0; k < vertical.taps; k++) {
+            int32_t sourceY = start + k;
+            int slot = sourceY % vertical.taps;
+            int16_t *row = &ring[rowLength * slot];
+            if (ringRows[slot] != sourceY) {
+                if (rgb565) {
+                    unpack565(reinterpret_cast<const uint16_t *>(rowOf(source, sourceY)), source->width, &unpacked[0]);
+                    filterRow(&unpacked[0], horizontal, destination->width, row);
+                } else {
+                    filterRow(rowOf(source, sourceY), horizontal, destination->width, row);
+                }
+                ringRows[slot] = sourceY;
+            }
+            taps[k] = row;
+        }
+
+        const int16_t *weights = &vertical.weights[static_cast<size_t>(y) * vertical.taps];
+        if (rgb565) {
+            filterColumn(&taps[0], weights, vertical.taps, rowLength, false, &packed[0]);
+            pack565(&packed[0], destination->width, reinterpret_cast<uint16_t *>(mutableRowOf(destination, y)));
+        } else {
+            filterColumn(&taps[0], weights, vertical.taps, rowLength, clampAlpha, mutableRowOf(destination, y));
+        }
+    }
+}
+
+}  // namespace
+
+int fluwx_resample(const fluwx_image *source, const fluwx_image *destination, fluwx_filter filter) {
+    if (!isValid(source) || !isValid(destination) || source->format != destination->format
+        || (filter != FLUWX_FILTER_AREA && filter != FLUWX_FILTER_LANCZOS3)) {
+        return FLUWX_ERROR_ARGUMENT;
+    }
+    if (source->width == destination->width && source->height == destination->height) {
+        size_t length = static_cast<size_t>(source->width) * (source->format == FLUWX_PIXEL_RGB_565 ? 2 : 4);
+        for (int32_t y = 0; y < source->height; y++) {
+            std::memmove(mutableRowOf(destination, y), rowOf(source, y), length);
+        }
+        return FLUWX_OK;
+    }
+    try {
+        resample(source, destination, filter);
+    } catch (const std::bad_alloc &) {
+        return FLUWX_ERROR_MEMORY;
+    }
+    return FLUWX_OK;
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2018 The OpenFlutter Organization
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fluwx_thumbnail.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Instead of searching quality and size by trial and error, the solver caps the pixel count from the
+// budget, does one probe encode and then predicts the quality and dimensions that land under the budget.
+
+namespace {
+
+// quality of the probe encode.
+const int32_t kProbeQuality = 85;
+
+// aim this far below the budget so that a slightly wrong estimate still fits.
+const double kTargetRatio = 0.85;
+
+// average bits per pixel of a photo at kProbeQuality, used to cap the pixel count before probing.
+const double kJpegBitsPerPixel = 2.0;
+
+// PNG has no quality knob, assume a generous bit rate for it.
+const double kPngBitsPerPixel = 8.0;
+
+// bits per pixel an encode can't exceed, whatever the image: uncompressed RGB for a JPEG at the
+// qualities the solver picks, RGBA plus the filter byte of each row for a PNG.
+const double kJpegMaxBitsPerPixel = 24.0;
+const double kPngMaxBitsPerPixel = 33.0;
+
+// JPEG qualities the solver may pick and their output size relative to kProbeQuality.
+const int32_t kQualities[] = {85, 80, 70, 60, 50, 40};
+const double kSizeFactors[] = {1.00, 0.83, 0.64, 0.54, 0.47, 0.41};
+const int kQualityCount = sizeof(kQualities) / sizeof(kQualities[0]);
+
+const int32_t kLastIndex = 3;
+
+double bitsPerPixel(fluwx_thumb_format format) {
+    return format == FLUWX_THUMB_PNG ? kPngBitsPerPixel : kJpegBitsPerPixel;
+}
+
+// source scaled to pixelScale times its pixel count, never up.
+void scaleStep(int32_t sourceWidth, int32_t sourceHeight, double pixelScale, fluwx_thumb_step *step) {
+    if (pixelScale >= 1) {
+        step->width = sourceWidth;
+        step->height = sourceHeight;
+        return;
+    }
+    double factor = std::sqrt(pixelScale);
+    step->width = std::max<int32_t>(1, static_cast<int32_t>(sourceWidth * factor));
+    step->height = std::max<int32_t>(1, static_cast<int32_t>(sourceHeight * factor));
+}
+
+}  // namespace
+
+int64_t fluwx_thumb_pixel_cap(int64_t max_bytes, fluwx_thumb_format format) {
+    return static_cast<int64_t>(max_bytes * 8.0 / bitsPerPixel(format));
+}
+
+int32_t fluwx_thumb_max_pixel_size(int64_t max_bytes) {
+    return static_cast<int32_t>(std::ceil(std::sqrt(max_bytes * 8.0 / kJpegBitsPerPixel * 2)));
+}
+
+void fluwx_thumb_first_step(int32_t source_width, int32_t source_height, int64_t max_bytes,
+                            fluwx_thumb_format format, fluwx_thumb_step *step) {
+    double pixels = static_cast<double>(source_width) * source_height;
+    scaleStep(source_width, source_height, max_bytes * 8.0 / bitsPerPixel(format) / pixels, step);
+    step->quality = kProbeQuality;
+    step->index = 1;
+}
+
+int fluwx_thumb_next_step(int32_t source_width, int32_t source_height, int64_t max_bytes,
+                          fluwx_thumb_format format, fluwx_thumb_step *step, int64_t encoded_length) {
+    if (encoded_length <= max_bytes || step->index >= kLastIndex) {
+        return 0;
+    }
+    double pixels = static_cast<double>(source_width) * source_height;
+    // every step is resampled from the source, so the scale is measured against it.
+    double pixelScale = static_cast<double>(step->width) * step->height / pixels;
+    double ratio = max_bytes * kTargetRatio / encoded_length;
+
+    if (step->index == 1) {
+        double pixelRatio = ratio;
+        if (format == FLUWX_THUMB_JPEG) {
+            step->quality = kQualities[kQualityCount - 1];
+            pixelRatio = ratio / kSizeFactors[kQualityCount - 1];
+            for (int i = 0; i < kQualityCount; i++) {
+                if (kSizeFactors[i] <= ratio) {
+                    step->quality = kQualities[i];
+                    pixelRatio = 1;
+                    break;
+                }
+            }
+        }
+        if (pixelRatio < 1) {
+            scaleStep(source_width, source_height, pixelScale * pixelRatio, step);
+        }
+    } else {
+        // the model overshot: shrink to a size that fits whatever the image looks like.
+        double maxBitsPerPixel = format == FLUWX_THUMB_PNG ? kPngMaxBitsPerPixel : kJpegMaxBitsPerPixel;
+        scaleStep(source_width, source_height,
+                  std::min(pixelScale * ratio, max_bytes * kTargetRatio * 8 / maxBitsPerPixel / pixels), step);
+    }
+    step->index++;
+    return 1;
+}
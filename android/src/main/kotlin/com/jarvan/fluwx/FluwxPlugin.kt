@@ -18,6 +18,8 @@ package com.jarvan.fluwx
 import com.jarvan.fluwx.constant.WeChatPluginMethods
 import com.jarvan.fluwx.constant.WeChatPluginMethods.IS_WE_CHAT_INSTALLED
 import com.jarvan.fluwx.handler.*
+import com.jarvan.fluwx.utils.MediaStats
+import com.jarvan.fluwx.utils.ScratchFiles
 import io.flutter.plugin.common.MethodCall
 import io.flutter.plugin.common.MethodChannel
 import io.flutter.plugin.common.MethodChannel.MethodCallHandler
@@ -33,6 +35,8 @@ class FluwxPlugin(private val registrar: Registrar, channel: MethodChannel) : Me
             FluwxRequestHandler.setRegistrar(registrar)
             FluwxResponseHandler.setMethodChannel(channel)
             channel.setMethodCallHandler(FluwxPlugin(registrar, channel))
+            // sweeps what earlier shares left behind, in the background.
+            ScratchFiles.getInstance(registrar.context())
         }
     }
 
@@ -105,13 +109,20 @@ class FluwxPlugin(private val registrar: Registrar, channel: MethodChannel) : Me
             return
         }
 
+        if (WeChatPluginMethods.GET_MEDIA_STATS == call.method) {
+            result.success(MediaStats.snapshot())
+            return
+        }
+
         if ("openWXApp" == call.method){
             val isSent = WXAPiHandler.wxApi?.openWXApp()?:false
             result.success(isSent)
             return
         }
 
-        if (call.method.startsWith("share")) {
+        if (call.method.startsWith("share")
+                || WeChatPluginMethods.PREPARE_SHARE == call.method
+                || WeChatPluginMethods.RELEASE_PREPARED_SHARE == call.method) {
             fluwxShareHandler.handle(call, result)
         } else {
             result.notImplemented()
@@ -6,4 +6,6 @@ public class CallResult {
     public static final String RESULT_API_NULL = "wxapi not configured";
     public static final String RESULT_WE_CHAT_NOT_INSTALLED = "wechat not installed";
     public static final String RESULT_FILE_NOT_EXIST = "file not exists";
+    public static final String RESULT_PREPARED_SHARE_NOT_FOUND = "prepared share not found";
+    public static final String RESULT_MEDIA_TOO_LARGE = "media too large";
 }
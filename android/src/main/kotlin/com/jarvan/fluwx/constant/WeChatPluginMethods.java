@@ -21,6 +21,10 @@ public class WeChatPluginMethods {
     public static final String SHARE_WEB_PAGE = "shareWebPage";
     public static final String SHARE_MINI_PROGRAM = "shareMiniProgram";
 
+    public static final String PREPARE_SHARE = "prepareShare";
+    public static final String SHARE_PREPARED = "sharePrepared";
+    public static final String RELEASE_PREPARED_SHARE = "releasePreparedShare";
+
     public static final String LAUNCH_MINI_PROGRAM = "launchMiniProgram";
     public static final String PAY = "payWithFluwx";
     public static final String WE_CHAT_PAY_RESPONSE = "onPayResponse";
@@ -28,4 +32,6 @@ public class WeChatPluginMethods {
     public static final String SUBSCRIBE_MSG = "subscribeMsg";
 
     public static final String AUTO_DEDUCT = "autoDeduct";
+
+    public static final String GET_MEDIA_STATS = "getMediaStats";
 }
@@ -8,6 +8,7 @@ package com.jarvan.fluwx.constant;
 public class WechatPluginKeys {
     public static final String ANDROID = "android";
     public static final String APP_ID = "appId";
+    public static final String MEDIA_HOSTS = "mediaHosts";
     public static final String PLATFORM = "platform";
     public static final String RESULT = "result";
 
@@ -30,4 +31,9 @@ public class WechatPluginKeys {
     public static final String MESSAGE_EXT = "messageExt";
     public static final String MEDIA_TAG_NAME = "mediaTagName ";
     public static final String MESSAGE_ACTION = "messageAction";
+
+    public static final String METHOD = "method";
+    public static final String MODEL = "model";
+    public static final String ID = "id";
+    public static final String TTL = "ttl";
 }
@@ -15,18 +15,27 @@
  */
 package com.jarvan.fluwx.handler
 
+import android.os.Handler
+import android.os.Looper
+import android.os.SystemClock
 import android.util.Log
 import com.jarvan.fluwx.constant.CallResult
 import com.jarvan.fluwx.constant.WeChatPluginMethods
 import com.jarvan.fluwx.constant.WechatPluginKeys
+import com.jarvan.fluwx.utils.ImageSource
+import com.jarvan.fluwx.utils.MediaStats
+import com.jarvan.fluwx.utils.MediaTooLargeException
+import com.jarvan.fluwx.utils.ScratchFiles
 import com.jarvan.fluwx.utils.ShareImageUtil
+import com.jarvan.fluwx.utils.ThumbnailSpec
 import com.jarvan.fluwx.utils.WeChatThumbnailUtil
 import com.tencent.mm.opensdk.modelmsg.*
 import io.flutter.plugin.common.MethodCall
 import io.flutter.plugin.common.MethodChannel
 import io.flutter.plugin.common.PluginRegistry
 import kotlinx.coroutines.*
-import java.io.ByteArrayInputStream
+import java.io.File
+import java.util.*
 
 
 /***
@@ -36,6 +45,31 @@ import java.io.ByteArrayInputStream
  **/
 internal class FluwxShareHandler {
 
+    companion object {
+        private val SHARE_METHODS = setOf(
+                WeChatPluginMethods.SHARE_TEXT,
+                WeChatPluginMethods.SHARE_MINI_PROGRAM,
+                WeChatPluginMethods.SHARE_IMAGE,
+                WeChatPluginMethods.SHARE_MUSIC,
+                WeChatPluginMethods.SHARE_VIDEO,
+                WeChatPluginMethods.SHARE_WEB_PAGE
+        )
+
+        private const val DEFAULT_PREPARED_SHARE_TTL = 5 * 60 * 1000L
+    }
+
+    /**
+     * the scene independent part of a share: image object and thumbnail, empty for text.
+     * [sharedFile] is the scratch file the image object points to, held until the media is released.
+     */
+    private class PreparedMedia(val image: WXImageObject? = null, val thumbData: ByteArray? = null, val sharedFile: File? = null)
+
+    private class PreparedShare(val call: MethodCall, val media: PreparedMedia)
+
+    // only touched on the main thread.
+    private val preparedShares = HashMap<String, PreparedShare>()
+
+    private val mainHandler = Handler(Looper.getMainLooper())
 
     private var channel: MethodChannel? = null
 
@@ -53,6 +87,17 @@ internal class FluwxShareHandler {
 
 
     fun handle(call: MethodCall, result: MethodChannel.Result) {
+        when (call.method) {
+            WeChatPluginMethods.PREPARE_SHARE -> {
+                prepareShare(call, result)
+                return
+            }
+            WeChatPluginMethods.RELEASE_PREPARED_SHARE -> {
+                result.success(releasePreparedShare(call.argument<String>(WechatPluginKeys.ID)))
+                return
+            }
+        }
+
         if (WXAPiHandler.wxApi == null) {
             result.error(CallResult.RESULT_API_NULL, "please config  wxapi first", null)
             return
@@ -64,45 +109,142 @@ internal class FluwxShareHandler {
 //        }
 
         when (call.method) {
-            WeChatPluginMethods.SHARE_TEXT -> shareText(call, result)
-            WeChatPluginMethods.SHARE_MINI_PROGRAM -> shareMiniProgram(call, result)
-            WeChatPluginMethods.SHARE_IMAGE -> shareImage(call, result)
-            WeChatPluginMethods.SHARE_MUSIC -> shareMusic(call, result)
-            WeChatPluginMethods.SHARE_VIDEO -> shareVideo(call, result)
-            WeChatPluginMethods.SHARE_WEB_PAGE -> shareWebPage(call, result)
+            WeChatPluginMethods.SHARE_TEXT -> shareText(call, null, result)
+            WeChatPluginMethods.SHARE_PREPARED -> sharePrepared(call, result)
+            in SHARE_METHODS -> {
+                GlobalScope.launch(Dispatchers.Main, CoroutineStart.DEFAULT) {
+                    val media = prepareMedia(call, result) ?: return@launch
+                    send(call, media, null, result)
+                    releaseMedia(media)
+                }
+            }
             else -> {
                 result.notImplemented()
             }
         }
     }
 
-    private fun shareText(call: MethodCall, result: MethodChannel.Result) {
+    /**
+     * prepares the media of a share model in the background and keeps it under a new id until it is
+     * released or its ttl has passed, so that it can be sent to several scenes.
+     */
+    private fun prepareShare(call: MethodCall, result: MethodChannel.Result) {
+        val method: String? = call.argument(WechatPluginKeys.METHOD)
+        if (method == null || method !in SHARE_METHODS) {
+            result.notImplemented()
+            return
+        }
+        val shareCall = MethodCall(method, call.argument<Map<String, Any?>>(WechatPluginKeys.MODEL))
+        val ttl = call.argument<Number>(WechatPluginKeys.TTL)?.toLong() ?: DEFAULT_PREPARED_SHARE_TTL
+
+        GlobalScope.launch(Dispatchers.Main, CoroutineStart.DEFAULT) {
+            val media = prepareMedia(shareCall, result) ?: return@launch
+            if (method == WeChatPluginMethods.SHARE_IMAGE && media.image == null) {
+                result.error(CallResult.RESULT_FILE_NOT_EXIST, CallResult.RESULT_FILE_NOT_EXIST, shareCall.argument<String>(WechatPluginKeys.IMAGE))
+                return@launch
+            }
+            val id = UUID.randomUUID().toString()
+            val preparedShare = PreparedShare(shareCall, media)
+            preparedShares[id] = preparedShare
+            mainHandler.postDelayed({
+                if (preparedShares[id] === preparedShare) {
+                    releasePreparedShare(id)
+                }
+            }, ttl)
+            result.success(id)
+        }
+    }
+
+    private fun sharePrepared(call: MethodCall, result: MethodChannel.Result) {
+        val id: String? = call.argument(WechatPluginKeys.ID)
+        val preparedShare = preparedShares[id]
+        if (preparedShare == null) {
+            result.error(CallResult.RESULT_PREPARED_SHARE_NOT_FOUND, CallResult.RESULT_PREPARED_SHARE_NOT_FOUND, id)
+            return
+        }
+        send(preparedShare.call, preparedShare.media, call.argument(WechatPluginKeys.SCENE), result)
+    }
+
+    private fun releasePreparedShare(id: String?): Boolean {
+        val preparedShare = preparedShares.remove(id) ?: return false
+        releaseMedia(preparedShare.media)
+        return true
+    }
+
+    private fun releaseMedia(media: PreparedMedia) {
+        val file = media.sharedFile ?: return
+        ScratchFiles.getInstance(registrar!!.context()).release(file)
+    }
+
+    /**
+     * [prepareMedia], or null once [result] has failed because a download was longer than its cap.
+     * The time the first share with media takes is kept in [MediaStats].
+     */
+    private suspend fun prepareMedia(call: MethodCall, result: MethodChannel.Result): PreparedMedia? {
+        val prewarmed = MediaStats.MEDIA_HOSTS_WARMED.get() > 0
+        val start = SystemClock.elapsedRealtime()
+        return try {
+            prepareMedia(call).also {
+                if (call.method != WeChatPluginMethods.SHARE_TEXT) {
+                    MediaStats.recordFirstShare(SystemClock.elapsedRealtime() - start, prewarmed)
+                }
+            }
+        } catch (e: MediaTooLargeException) {
+            result.error(CallResult.RESULT_MEDIA_TOO_LARGE, e.message, mapOf("url" to e.url, "limit" to e.limit))
+            null
+        }
+    }
+
+    /**
+     * does the downloads, decoding and compression a share needs; everything that doesn't depend on the scene.
+     *
+     * @throws MediaTooLargeException if the image or thumbnail is longer than its cap in [ThumbnailSpec].
+     */
+    private suspend fun prepareMedia(call: MethodCall): PreparedMedia {
+        val thumbnail: String? = call.argument(WechatPluginKeys.THUMBNAIL)
+        if (call.method != WeChatPluginMethods.SHARE_TEXT) {
+            MediaStats.MEDIA_SHARES.incrementAndGet()
+        }
+        return when (call.method) {
+            WeChatPluginMethods.SHARE_TEXT -> PreparedMedia()
+            WeChatPluginMethods.SHARE_IMAGE -> prepareImage(call)
+            WeChatPluginMethods.SHARE_MINI_PROGRAM -> {
+                PreparedMedia(thumbData = if (thumbnail.isNullOrBlank()) null else getThumbnailByteArrayMiniProgram(registrar, thumbnail))
+            }
+            else -> {
+                PreparedMedia(thumbData = if (thumbnail.isNullOrBlank()) null else getThumbnailByteArrayCommon(registrar, thumbnail))
+            }
+        }
+    }
+
+    /**
+     * builds the message from prepared media and sends it. [scene] overrides the scene of [call].
+     */
+    private fun send(call: MethodCall, media: PreparedMedia, scene: String?, result: MethodChannel.Result) {
+        when (call.method) {
+            WeChatPluginMethods.SHARE_TEXT -> shareText(call, scene, result)
+            WeChatPluginMethods.SHARE_MINI_PROGRAM -> shareMiniProgram(call, media, scene, result)
+            WeChatPluginMethods.SHARE_IMAGE -> shareImage(call, media, scene, result)
+            WeChatPluginMethods.SHARE_MUSIC -> shareMusic(call, media, scene, result)
+            WeChatPluginMethods.SHARE_VIDEO -> shareVideo(call, media, scene, result)
+            WeChatPluginMethods.SHARE_WEB_PAGE -> shareWebPage(call, media, scene, result)
+            else -> {
+                result.notImplemented()
+            }
+        }
+    }
+
+    private fun shareText(call: MethodCall, scene: String?, result: MethodChannel.Result) {
         val textObj = WXTextObject()
         textObj.text = call.argument(WechatPluginKeys.TEXT)
         val msg = WXMediaMessage()
         msg.mediaObject = textObj
         msg.description = call.argument(WechatPluginKeys.TEXT)
-        val req = SendMessageToWX.Req()
-        req.message = msg
-        msg.description
-
-        msg.messageAction = call.argument<String>(WechatPluginKeys.MESSAGE_ACTION)
-        msg.messageExt = call.argument<String>(WechatPluginKeys.MESSAGE_EXT)
-        msg.mediaTagName = call.argument<String>(WechatPluginKeys.MEDIA_TAG_NAME)
-
-        setCommonArguments(call, req, msg)
-        val done = WXAPiHandler.wxApi?.sendReq(req)
-        result.success(
-                mapOf(
-                        WechatPluginKeys.PLATFORM to WechatPluginKeys.ANDROID,
-                        WechatPluginKeys.RESULT to done
-                )
-        )
-
+        sendRequest(call, msg, scene, result)
     }
 
 
-    private fun shareMiniProgram(call: MethodCall, result: MethodChannel.Result) {
+    private fun shareMiniProgram(call: MethodCall, media: PreparedMedia, scene: String?, result: MethodChannel.Result) {
         val miniProgramObj = WXMiniProgramObject()
         miniProgramObj.webpageUrl = call.argument("webPageUrl") // 兼容低版本的网页链接
         miniProgramObj.miniprogramType = call.argument("miniProgramType") ?: 0// 正式版:0，测试版:1，体验版:2
@@ -112,28 +254,8 @@ internal class FluwxShareHandler {
         val msg = WXMediaMessage(miniProgramObj)
         msg.title = call.argument(WechatPluginKeys.TITLE)                   // 小程序消息title
         msg.description = call.argument("description")               // 小程序消息desc
-        val thumbnail: String? = call.argument(WechatPluginKeys.THUMBNAIL)
-
-        GlobalScope.launch((Dispatchers.Main), CoroutineStart.DEFAULT) {
-            if (thumbnail.isNullOrBlank()) {
-                msg.thumbData = null
-            } else {
-                msg.thumbData = getThumbnailByteArrayMiniProgram(registrar, thumbnail)
-            }
-            val req = SendMessageToWX.Req()
-            setCommonArguments(call, req, msg)
-            req.message = msg
-            val done = WXAPiHandler.wxApi?.sendReq(req)
-            result.success(
-                    mapOf(
-                            WechatPluginKeys.PLATFORM to WechatPluginKeys.ANDROID,
-                            WechatPluginKeys.RESULT to done
-                    )
-            )
-
-        }
-
-
+        msg.thumbData = media.thumbData
+        sendRequest(call, msg, scene, result)
     }
 
     private suspend fun getThumbnailByteArrayMiniProgram(registrar: PluginRegistry.Registrar?, thumbnail: String): ByteArray {
@@ -144,9 +266,10 @@ internal class FluwxShareHandler {
         }.await()
     }
 
-    private suspend fun getImageByteArrayCommon(registrar: PluginRegistry.Registrar?, imagePath: String): ByteArray {
-        return GlobalScope.async(Dispatchers.Default, CoroutineStart.DEFAULT) {
-            val result = ShareImageUtil.getImageData(registrar, imagePath)
+    private suspend fun getImageByteArrayCommon(registrar: PluginRegistry.Registrar?, imagePath: String, source: ImageSource?): ByteArray {
+        // mostly waiting on the network or disk.
+        return GlobalScope.async(Dispatchers.IO, CoroutineStart.DEFAULT) {
+            val result = ShareImageUtil.getImageData(registrar, imagePath, source)
             result ?: byteArrayOf()
         }.await()
     }
@@ -164,88 +287,119 @@ internal class FluwxShareHandler {
         }.await()
     }
 
-    private fun shareImage(call: MethodCall, result: MethodChannel.Result) {
-        val imagePath = call.argument<String>(WechatPluginKeys.IMAGE)
-
-
-        GlobalScope.launch(Dispatchers.Main, CoroutineStart.DEFAULT) {
-            val byteArray: ByteArray? = if (imagePath.isNullOrBlank()) {
-                byteArrayOf()
+    /**
+     * not a child of the caller: once the file is acquired the result is kept even if the caller fails, so
+     * [releaseSharedFile] can hand it back.
+     */
+    private fun getSharedImageFileAsync(registrar: PluginRegistry.Registrar?, byteArray: Deferred<ByteArray>, imagePath: String?): Deferred<File?> {
+        return GlobalScope.async(Dispatchers.IO, CoroutineStart.DEFAULT) {
+            val bytes = byteArray.await()
+            if (bytes.size > 512 * 1024) {
+                ScratchFiles.getInstance(registrar!!.context()).acquire(bytes, ShareImageUtil.suffixOf(bytes, imagePath))
             } else {
-                getImageByteArrayCommon(registrar, imagePath)
+                null
             }
+        }
+    }
 
+    /**
+     * releases the file [sharedFile] acquires, whenever it does, for a share that failed before it was sent.
+     */
+    private fun releaseSharedFile(registrar: PluginRegistry.Registrar?, sharedFile: Deferred<File?>) {
+        GlobalScope.launch(Dispatchers.IO) {
+            val file = try {
+                sharedFile.await()
+            } catch (e: Exception) {
+                null
+            }
+            if (file != null) {
+                ScratchFiles.getInstance(registrar!!.context()).release(file)
+            }
+        }
+    }
 
+    private suspend fun getThumbnailByteArrayOfImage(registrar: PluginRegistry.Registrar?, source: ImageSource): ByteArray {
+        return GlobalScope.async(Dispatchers.Default, CoroutineStart.DEFAULT) {
+            val result = WeChatThumbnailUtil.thumbnailForImage(source, registrar)
+            result ?: byteArrayOf()
+        }.await()
+    }
 
+    /**
+     * reads the image and makes the thumbnail concurrently. Only a thumbnail made from the image itself waits
+     * for it, and writing a large image to a file overlaps with that thumbnail.
+     *
+     * @return media without an image if it can't be read.
+     */
+    private suspend fun prepareImage(call: MethodCall): PreparedMedia = coroutineScope {
+        val imagePath = call.argument<String>(WechatPluginKeys.IMAGE)
+        val thumbnail: String? = call.argument(WechatPluginKeys.THUMBNAIL)
+        // shared by the image and its thumbnail for the whole request, a network image is downloaded once.
+        val source = if (imagePath.isNullOrBlank()) null else ImageSource.from(registrar, imagePath, ThumbnailSpec.MAX_IMAGE_FETCH_BYTES)
 
-            val imgObj = if (byteArray != null && byteArray.isNotEmpty()) {
+        val byteArray = async {
+            if (imagePath.isNullOrBlank()) {
+                byteArrayOf()
+            } else {
+                getImageByteArrayCommon(registrar, imagePath, source)
+            }
+        }
 
-                if (byteArray.size > 512 * 1024){
-                    val input = ByteArrayInputStream(byteArray)
+        val thumbnailData = async {
+            if ((thumbnail.isNullOrBlank() || thumbnail == imagePath) && source != null) {
+                // reading the source first keeps the thumbnail from fetching it on its own.
+                byteArray.await()
+                getThumbnailByteArrayOfImage(registrar, source)
+            } else if (thumbnail.isNullOrBlank()) {
+                byteArrayOf()
+            } else {
+                getThumbnailByteArrayCommon(registrar, thumbnail)
+            }
+        }
 
-                    val suffix  = when {
-                        imagePath.isNullOrBlank() -> ".jpeg"
-                        imagePath.lastIndexOf(".") == -1 -> ".jpeg"
-                        else -> imagePath.substring(imagePath.lastIndexOf("."))
-                    }
+        val sharedFile = getSharedImageFileAsync(registrar, byteArray, imagePath)
 
-                    val file = ShareImageUtil.inputStreamToFile(input,suffix,registrar!!.context())
+        try {
+            val bytes = byteArray.await()
+            if (bytes.isEmpty()) {
+                thumbnailData.cancel()
+                PreparedMedia()
+            } else {
+                val thumbData = thumbnailData.await()
+                val file = sharedFile.await()
+                val imgObj = if (file != null) {
                     WXImageObject().apply {
                         setImagePath(file.absolutePath)
                     }
-                }else{
-                    WXImageObject(byteArray)
+                } else {
+                    WXImageObject(bytes)
                 }
-
-            } else {
-                null
+                PreparedMedia(imgObj, thumbData, file)
             }
-
-            if (imgObj == null) {
-                result.error(CallResult.RESULT_FILE_NOT_EXIST, CallResult.RESULT_FILE_NOT_EXIST, imagePath)
-                return@launch
-            }
-
-            var thumbnail: String? = call.argument(WechatPluginKeys.THUMBNAIL)
-
-            if (thumbnail.isNullOrBlank()) {
-                thumbnail = imagePath
-            }
-
-            val thumbnailData = getThumbnailByteArrayCommon(registrar, thumbnail!!)
-
-//           val thumbnailData =  Util.bmpToByteArray(bitmap,true)
-            handleShareImage(imgObj, call, thumbnailData, result)
+        } catch (e: Throwable) {
+            // e.g. the thumbnail was too large to download: nothing will release the file otherwise.
+            releaseSharedFile(registrar, sharedFile)
+            throw e
         }
-
     }
 
-    private fun handleShareImage(imgObj: WXImageObject, call: MethodCall, thumbnailData: ByteArray?, result: MethodChannel.Result) {
+    private fun shareImage(call: MethodCall, media: PreparedMedia, scene: String?, result: MethodChannel.Result) {
+        val imgObj = media.image
+        if (imgObj == null) {
+            result.error(CallResult.RESULT_FILE_NOT_EXIST, CallResult.RESULT_FILE_NOT_EXIST, call.argument<String>(WechatPluginKeys.IMAGE))
+            return
+        }
 
         val msg = WXMediaMessage()
         msg.mediaObject = imgObj
-        if (thumbnailData == null || thumbnailData.isEmpty()) {
-            msg.thumbData = null
-        } else {
-            msg.thumbData = thumbnailData
-        }
+        msg.thumbData = media.thumbData
 
         msg.title = call.argument<String>(WechatPluginKeys.TITLE)
         msg.description = call.argument<String>(WechatPluginKeys.DESCRIPTION)
-
-        val req = SendMessageToWX.Req()
-        setCommonArguments(call, req, msg)
-        req.message = msg
-        val done = WXAPiHandler.wxApi?.sendReq(req)
-        result.success(
-                mapOf(
-                        WechatPluginKeys.PLATFORM to WechatPluginKeys.ANDROID,
-                        WechatPluginKeys.RESULT to done
-                )
-        )
+        sendRequest(call, msg, scene, result)
     }
 
-    private fun shareMusic(call: MethodCall, result: MethodChannel.Result) {
+    private fun shareMusic(call: MethodCall, media: PreparedMedia, scene: String?, result: MethodChannel.Result) {
         val music = WXMusicObject()
         val musicUrl: String? = call.argument("musicUrl")
         val musicLowBandUrl: String? = call.argument("musicLowBandUrl")
@@ -260,29 +414,11 @@ internal class FluwxShareHandler {
         msg.mediaObject = music
         msg.title = call.argument("title")
         msg.description = call.argument("description")
-        val thumbnail: String? = call.argument("thumbnail")
-
-        GlobalScope.launch(Dispatchers.Main, CoroutineStart.DEFAULT) {
-            if (thumbnail != null && thumbnail.isNotBlank()) {
-                msg.thumbData = getThumbnailByteArrayCommon(registrar, thumbnail)
-            }
-
-            val req = SendMessageToWX.Req()
-            setCommonArguments(call, req, msg)
-            req.message = msg
-            val done = WXAPiHandler.wxApi?.sendReq(req)
-            result.success(
-                    mapOf(
-                            WechatPluginKeys.PLATFORM to WechatPluginKeys.ANDROID,
-                            WechatPluginKeys.RESULT to done
-                    )
-            )
-        }
-
-
+        msg.thumbData = media.thumbData
+        sendRequest(call, msg, scene, result)
     }
 
-    private fun shareVideo(call: MethodCall, result: MethodChannel.Result) {
+    private fun shareVideo(call: MethodCall, media: PreparedMedia, scene: String?, result: MethodChannel.Result) {
         val video = WXVideoObject()
         val videoUrl: String? = call.argument("videoUrl")
         val videoLowBandUrl: String? = call.argument("videoLowBandUrl")
@@ -295,29 +431,12 @@ internal class FluwxShareHandler {
         msg.mediaObject = video
         msg.title = call.argument(WechatPluginKeys.TITLE)
         msg.description = call.argument(WechatPluginKeys.DESCRIPTION)
-        val thumbnail: String? = call.argument(WechatPluginKeys.THUMBNAIL)
-
-        GlobalScope.launch(Dispatchers.Main, CoroutineStart.DEFAULT) {
-            if (thumbnail != null && thumbnail.isNotBlank()) {
-                msg.thumbData = getThumbnailByteArrayCommon(registrar, thumbnail)
-            }
-            val req = SendMessageToWX.Req()
-            setCommonArguments(call, req, msg)
-            req.message = msg
-            val done = WXAPiHandler.wxApi?.sendReq(req)
-            result.success(
-                    mapOf(
-                            WechatPluginKeys.PLATFORM to WechatPluginKeys.ANDROID,
-                            WechatPluginKeys.RESULT to done
-                    )
-            )
-        }
-
-
+        msg.thumbData = media.thumbData
+        sendRequest(call, msg, scene, result)
     }
 
 
-    private fun shareWebPage(call: MethodCall, result: MethodChannel.Result) {
+    private fun shareWebPage(call: MethodCall, media: PreparedMedia, scene: String?, result: MethodChannel.Result) {
         val webPage = WXWebpageObject()
         webPage.webpageUrl = call.argument("webPage")
         val msg = WXMediaMessage()
@@ -325,43 +444,25 @@ internal class FluwxShareHandler {
         msg.mediaObject = webPage
         msg.title = call.argument(WechatPluginKeys.TITLE)
         msg.description = call.argument(WechatPluginKeys.DESCRIPTION)
-        val thumbnail: String? = call.argument(WechatPluginKeys.THUMBNAIL)
-        GlobalScope.launch(Dispatchers.Main, CoroutineStart.DEFAULT) {
-            if (thumbnail != null && thumbnail.isNotBlank()) {
-                msg.thumbData = getThumbnailByteArrayCommon(registrar, thumbnail)
-            }
-            val req = SendMessageToWX.Req()
-            setCommonArguments(call, req, msg)
-            req.message = msg
-            val done = WXAPiHandler.wxApi?.sendReq(req)
-            result.success(
-                    mapOf(
-                            WechatPluginKeys.PLATFORM to WechatPluginKeys.ANDROID,
-                            WechatPluginKeys.RESULT to done
-                    )
-            )
-        }
+        msg.thumbData = media.thumbData
+        sendRequest(call, msg, scene, result)
     }
 
-    //    private fun createWxImageObject(imagePath:String):WXImageObject?{
-//        var imgObj: WXImageObject? = null
-//        var imageFile:File? = null
-//        if (imagePath.startsWith(WeChatPluginImageSchema.SCHEMA_ASSETS)){
-//            val key = imagePath.substring(WeChatPluginImageSchema.SCHEMA_ASSETS.length, imagePath.length)
-//            val assetFileDescriptor = AssetManagerUtil.openAsset(registrar,key,"")
-//            imageFile  = FileUtil.createTmpFile(assetFileDescriptor)
-//        }else if (imagePath.startsWith(WeChatPluginImageSchema.SCHEMA_FILE)){
-//            imageFile = File(imagePath)
-//        }
-//        if(imageFile != null && imageFile.exists()){
-//            imgObj = WXImageObject()
-//            imgObj.setImagePath(imagePath)
-//        }else{
-//            Log.d(WechatPlugin.TAG,CallResult.RESULT_FILE_NOT_EXIST)
-//        }
-//
-//        return  imgObj
-//    }
+    private fun sendRequest(call: MethodCall, msg: WXMediaMessage, scene: String?, result: MethodChannel.Result) {
+        if (msg.thumbData != null && msg.thumbData.isEmpty()) {
+            msg.thumbData = null
+        }
+        val req = SendMessageToWX.Req()
+        setCommonArguments(call, req, msg, scene)
+        req.message = msg
+        val done = WXAPiHandler.wxApi?.sendReq(req)
+        result.success(
+                mapOf(
+                        WechatPluginKeys.PLATFORM to WechatPluginKeys.ANDROID,
+                        WechatPluginKeys.RESULT to done
+                )
+        )
+    }
 
 
     private fun getScene(value: String) = when (value) {
@@ -371,12 +472,12 @@ internal class FluwxShareHandler {
         else -> SendMessageToWX.Req.WXSceneTimeline
     }
 
-    private fun setCommonArguments(call: MethodCall, req: SendMessageToWX.Req, msg: WXMediaMessage) {
+    private fun setCommonArguments(call: MethodCall, req: SendMessageToWX.Req, msg: WXMediaMessage, scene: String?) {
         msg.messageAction = call.argument<String>(WechatPluginKeys.MESSAGE_ACTION)
         msg.messageExt = call.argument<String>(WechatPluginKeys.MESSAGE_EXT)
         msg.mediaTagName = call.argument<String>(WechatPluginKeys.MEDIA_TAG_NAME)
         req.transaction = call.argument(WechatPluginKeys.TRANSACTION)
-        req.scene = getScene(call.argument(WechatPluginKeys.SCENE)
+        req.scene = getScene(scene ?: call.argument(WechatPluginKeys.SCENE)
                 ?: WechatPluginKeys.SCENE_SESSION)
     }
 
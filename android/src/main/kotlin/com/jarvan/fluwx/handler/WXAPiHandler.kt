@@ -17,6 +17,7 @@ package com.jarvan.fluwx.handler
 
 import com.jarvan.fluwx.constant.CallResult
 import com.jarvan.fluwx.constant.WechatPluginKeys
+import com.jarvan.fluwx.utils.MediaFetcher
 import com.tencent.mm.opensdk.openapi.IWXAPI
 import com.tencent.mm.opensdk.openapi.WXAPIFactory
 import io.flutter.plugin.common.MethodCall
@@ -40,6 +41,12 @@ object WXAPiHandler {
             return
         }
 
+        // off the main thread; the first share then finds connections to its CDN open.
+        val mediaHosts: List<String>? = call.argument(WechatPluginKeys.MEDIA_HOSTS)
+        if (!mediaHosts.isNullOrEmpty()) {
+            MediaFetcher.getInstance(registrar!!.context()).prewarm(mediaHosts)
+        }
+
         if (wxApi != null) {
             result.success(mapOf(
                     WechatPluginKeys.PLATFORM to WechatPluginKeys.ANDROID,
@@ -15,6 +15,8 @@
  */
 package com.jarvan.fluwx.utils;
 
+import android.content.Context;
+import android.content.pm.PackageManager;
 import android.content.res.AssetFileDescriptor;
 import android.content.res.AssetManager;
 import android.text.TextUtils;
@@ -24,19 +26,24 @@ import java.io.IOException;
 import io.flutter.plugin.common.PluginRegistry;
 
 public final class AssetManagerUtil {
+    private static long appLastUpdateTime;
+
     private AssetManagerUtil() {
         throw new RuntimeException("can't do this");
     }
 
-    public static AssetFileDescriptor openAsset(PluginRegistry.Registrar registrar, String assetKey, String assetPackage) {
-        AssetFileDescriptor fd = null;
-        AssetManager assetManager = registrar.context().getAssets();
-        String key;
+    public static String lookupKey(PluginRegistry.Registrar registrar, String assetKey, String assetPackage) {
         if (TextUtils.isEmpty(assetPackage)) {
-            key = registrar.lookupKeyForAsset(assetKey);
+            return registrar.lookupKeyForAsset(assetKey);
         } else {
-            key = registrar.lookupKeyForAsset(assetKey, assetPackage);
+            return registrar.lookupKeyForAsset(assetKey, assetPackage);
         }
+    }
+
+    public static AssetFileDescriptor openAsset(PluginRegistry.Registrar registrar, String assetKey, String assetPackage) {
+        AssetFileDescriptor fd = null;
+        AssetManager assetManager = registrar.context().getAssets();
+        String key = lookupKey(registrar, assetKey, assetPackage);
         try {
             fd = assetManager.openFd(key);
         } catch (IOException e) {
@@ -44,4 +51,18 @@ public final class AssetManagerUtil {
         }
         return fd;
     }
+
+    /**
+     * when the app, and so its assets, was last installed or updated.
+     */
+    public static synchronized long appLastUpdateTime(Context context) {
+        if (appLastUpdateTime == 0) {
+            try {
+                appLastUpdateTime = context.getPackageManager().getPackageInfo(context.getPackageName(), 0).lastUpdateTime;
+            } catch (PackageManager.NameNotFoundException e) {
+                appLastUpdateTime = -1;
+            }
+        }
+        return appLastUpdateTime;
+    }
 }
@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2018 The OpenFlutter Organization
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.jarvan.fluwx.utils;
+
+import android.annotation.TargetApi;
+import android.graphics.Bitmap;
+import android.graphics.BitmapFactory;
+import android.graphics.Color;
+import android.os.Build;
+
+import java.util.ArrayList;
+import java.util.Iterator;
+import java.util.List;
+
+/**
+ * Bitmaps kept for reuse as decode targets ({@link BitmapFactory.Options#inBitmap}) and as the output of
+ * resampling, so a burst of shares doesn't allocate and drop a bitmap per step.
+ * <p>
+ * Bitmaps are matched by allocation size and reconfigured to the size and config asked for, which needs
+ * KitKat; below it nothing is pooled. At most {@link #MAX_POOL_SIZE} bytes are kept, least recently
+ * returned dropped first. Hits, misses and bytes allocated are counted in {@link MediaStats}.
+ */
+public final class BitmapPool {
+
+    private static final long MAX_POOL_SIZE = Math.min(32 * 1024 * 1024, Runtime.getRuntime().maxMemory() / 8);
+
+    /**
+     * a pooled bitmap is only handed out for a request of at least 1 / this of its size.
+     */
+    private static final int MAX_SIZE_MULTIPLE = 4;
+
+    // in the order they were returned.
+    private static final List<Bitmap> bitmaps = new ArrayList<>();
+    private static long pooledSize;
+
+    private BitmapPool() {
+    }
+
+    /**
+     * RGB_565 if the image is opaque and is going to be encoded as a JPEG, which has no alpha and
+     * no more precision to keep; ARGB_8888 otherwise.
+     */
+    public static Bitmap.Config configFor(boolean opaque, boolean toJpeg) {
+        return opaque && toJpeg ? Bitmap.Config.RGB_565 : Bitmap.Config.ARGB_8888;
+    }
+
+    /**
+     * @return a cleared bitmap of {@code width x height}, from the pool or new.
+     */
+    public static Bitmap get(int width, int height, Bitmap.Config config) {
+        Bitmap bitmap = take(width, height, config);
+        if (bitmap != null) {
+            bitmap.eraseColor(Color.TRANSPARENT);
+            return bitmap;
+        }
+        bitmap = Bitmap.createBitmap(width, height, config);
+        allocated(bitmap);
+        return bitmap;
+    }
+
+    /**
+     * sets a pooled bitmap large enough for {@code width x height} as the decode target of {@code options};
+     * the decoder reconfigures it to the decoded size. The caller decodes with {@link #decoded(Bitmap, BitmapFactory.Options)}.
+     */
+    public static void prepareDecode(BitmapFactory.Options options, int width, int height) {
+        Bitmap.Config config = options.inPreferredConfig == null ? Bitmap.Config.ARGB_8888 : options.inPreferredConfig;
+        options.inMutable = true;
+        options.inBitmap = take(width, height, config);
+    }
+
+    /**
+     * accounts for the result of a decode prepared with {@link #prepareDecode}: if the decoder allocated a bitmap
+     * of its own, the pooled one goes back.
+     */
+    public static Bitmap decoded(Bitmap result, BitmapFactory.Options options) {
+        Bitmap target = options.inBitmap;
+        options.inBitmap = null;
+        if (result != null && result != target) {
+            allocated(result);
+        }
+        if (target != null && target != result) {
+            put(target);
+        }
+        return result;
+    }
+
+    /**
+     * takes {@code bitmap} back instead of recycling it. Whoever returns it must not use it anymore.
+     */
+    public static void put(Bitmap bitmap) {
+        if (bitmap == null || bitmap.isRecycled()) {
+            return;
+        }
+        if (!isPoolable(bitmap)) {
+            bitmap.recycle();
+            return;
+        }
+        synchronized (BitmapPool.class) {
+            bitmaps.add(bitmap);
+            pooledSize += allocationByteCount(bitmap);
+            Iterator<Bitmap> iterator = bitmaps.iterator();
+            while (pooledSize > MAX_POOL_SIZE && iterator.hasNext()) {
+                Bitmap evicted = iterator.next();
+                iterator.remove();
+                pooledSize -= allocationByteCount(evicted);
+                evicted.recycle();
+            }
+        }
+    }
+
+    private static Bitmap take(int width, int height, Bitmap.Config config) {
+        if (Build.VERSION.SDK_INT < Build.VERSION_CODES.KITKAT) {
+            return null;
+        }
+        long needed = (long) width * height * bytesPerPixel(config);
+        synchronized (BitmapPool.class) {
+            int best = -1;
+            for (int i = 0; i < bitmaps.size(); i++) {
+                long size = allocationByteCount(bitmaps.get(i));
+                if (size >= needed && size <= needed * MAX_SIZE_MULTIPLE
+                        && (best == -1 || size < allocationByteCount(bitmaps.get(best)))) {
+                    best = i;
+                }
+            }
+            if (best == -1) {
+                MediaStats.BITMAP_POOL_MISSES.incrementAndGet();
+                return null;
+            }
+            Bitmap bitmap = bitmaps.remove(best);
+            pooledSize -= allocationByteCount(bitmap);
+            MediaStats.BITMAP_POOL_HITS.incrementAndGet();
+            reconfigure(bitmap, width, height, config);
+            return bitmap;
+        }
+    }
+
+    @TargetApi(Build.VERSION_CODES.KITKAT)
+    private static void reconfigure(Bitmap bitmap, int width, int height, Bitmap.Config config) {
+        bitmap.reconfigure(width, height, config);
+    }
+
+    private static boolean isPoolable(Bitmap bitmap) {
+        return Build.VERSION.SDK_INT >= Build.VERSION_CODES.KITKAT
+                && bitmap.isMutable()
+                && (bitmap.getConfig() == Bitmap.Config.ARGB_8888 || bitmap.getConfig() == Bitmap.Config.RGB_565)
+                && allocationByteCount(bitmap) <= MAX_POOL_SIZE / 2;
+    }
+
+    /**
+     * counts a bitmap a decoder allocated itself.
+     */
+    static void allocated(Bitmap bitmap) {
+        if (bitmap != null) {
+            MediaStats.BITMAP_BYTES_ALLOCATED.addAndGet(allocationByteCount(bitmap));
+        }
+    }
+
+    private static long allocationByteCount(Bitmap bitmap) {
+        if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.KITKAT) {
+            return bitmap.getAllocationByteCount();
+        }
+        return bitmap.getByteCount();
+    }
+
+    private static int bytesPerPixel(Bitmap.Config config) {
+        return config == Bitmap.Config.RGB_565 ? 2 : 4;
+    }
+}
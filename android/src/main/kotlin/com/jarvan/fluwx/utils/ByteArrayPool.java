@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2018 The OpenFlutter Organization
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.jarvan.fluwx.utils;
+
+import java.util.ArrayList;
+import java.util.List;
+
+/**
+ * Byte arrays kept for reuse by {@link PooledByteArrayOutputStream}, so every encode and every read of a
+ * stream of unknown length doesn't allocate, and grow, a fresh buffer. At most {@link #MAX_POOL_SIZE}
+ * bytes are kept; the arrays released longest ago are dropped first.
+ */
+final class ByteArrayPool {
+
+    private static final int MAX_POOL_SIZE = 4 * 1024 * 1024;
+    private static final int MIN_ARRAY_LENGTH = 8 * 1024;
+
+    // in the order they were released.
+    private static final List<byte[]> arrays = new ArrayList<>();
+    private static int pooledSize;
+
+    private ByteArrayPool() {
+    }
+
+    /**
+     * @return the smallest pooled array of at least {@code minLength} bytes, or a new one. Its content is undefined.
+     */
+    static synchronized byte[] acquire(int minLength) {
+        int best = -1;
+        for (int i = 0; i < arrays.size(); i++) {
+            int length = arrays.get(i).length;
+            if (length >= minLength && (best == -1 || length < arrays.get(best).length)) {
+                best = i;
+            }
+        }
+        if (best == -1) {
+            return new byte[Math.max(minLength, MIN_ARRAY_LENGTH)];
+        }
+        byte[] array = arrays.remove(best);
+        pooledSize -= array.length;
+        return array;
+    }
+
+    static synchronized void release(byte[] array) {
+        if (array == null || array.length > MAX_POOL_SIZE / 2) {
+            return;
+        }
+        arrays.add(array);
+        pooledSize += array.length;
+        while (pooledSize > MAX_POOL_SIZE) {
+            pooledSize -= arrays.remove(0).length;
+        }
+    }
+}
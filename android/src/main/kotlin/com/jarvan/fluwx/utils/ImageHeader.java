@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2018 The OpenFlutter Organization
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.jarvan.fluwx.utils;
+
+import java.io.BufferedInputStream;
+import java.io.DataInputStream;
+import java.io.EOFException;
+import java.io.IOException;
+import java.io.InputStream;
+import java.util.Arrays;
+
+/**
+ * Format, dimensions, EXIF orientation and embedded EXIF thumbnail of a JPEG or PNG,
+ * read from its header without decoding any pixels.
+ */
+public class ImageHeader {
+    public static final int FORMAT_UNKNOWN = 0;
+    public static final int FORMAT_JPEG = 1;
+    public static final int FORMAT_PNG = 2;
+
+    public static final int ORIENTATION_NORMAL = 1;
+
+    private static final int TAG_ORIENTATION = 0x0112;
+    private static final int TAG_THUMBNAIL_OFFSET = 0x0201;
+    private static final int TAG_THUMBNAIL_LENGTH = 0x0202;
+
+    public int format = FORMAT_UNKNOWN;
+
+    /**
+     * stored size, before {@link #orientation} is applied. 0 if unknown.
+     */
+    public int width;
+    public int height;
+
+    /**
+     * EXIF orientation, 1 to 8.
+     */
+    public int orientation = ORIENTATION_NORMAL;
+
+    /**
+     * the JPEG thumbnail stored in EXIF IFD1, or null. Stored unrotated, {@link #orientation} applies to it as well.
+     */
+    public byte[] thumbnail;
+
+    public boolean hasSize() {
+        return width > 0 && height > 0;
+    }
+
+    /**
+     * @return true if the orientation swaps width and height.
+     */
+    public boolean isTransposed() {
+        return orientation >= 5 && orientation <= 8;
+    }
+
+    /**
+     * reads as little of {@code inputStream} as needed. The caller closes the stream.
+     */
+    public static ImageHeader parse(InputStream inputStream) throws IOException {
+        ImageHeader header = new ImageHeader();
+        DataInputStream input = new DataInputStream(new BufferedInputStream(inputStream, 1024));
+        try {
+            int first = input.readUnsignedByte();
+            int second = input.readUnsignedByte();
+            if (first == 0xFF && second == 0xD8) {
+                header.format = FORMAT_JPEG;
+                header.parseJpeg(input);
+            } else if (first == 0x89 && second == 'P') {
+                header.parsePng(input);
+            }
+        } catch (EOFException e) {
+            // truncated, keep what has been read so far.
+        }
+        return header;
+    }
+
+    private void parsePng(DataInputStream input) throws IOException {
+        byte[] signature = new byte[6];
+        input.readFully(signature);
+        if (signature[0] != 'N' || signature[1] != 'G') {
+            return;
+        }
+        format = FORMAT_PNG;
+        input.readInt(); // IHDR length
+        if (input.readInt() != 0x49484452) { // IHDR
+            return;
+        }
+        width = input.readInt();
+        height = input.readInt();
+    }
+
+    private void parseJpeg(DataInputStream input) throws IOException {
+        while (true) {
+            if (input.readUnsignedByte() != 0xFF) {
+                return;
+            }
+            int marker;
+            do {
+                marker = input.readUnsignedByte();
+            } while (marker == 0xFF);
+
+            // start of scan or end of image: no more header segments.
+            if (marker == 0xDA || marker == 0xD9) {
+                return;
+            }
+            // markers without a payload.
+            if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+                continue;
+            }
+
+            int length = input.readUnsignedShort() - 2;
+            if (length < 0) {
+                return;
+            }
+
+            if (marker == 0xE1) {
+                byte[] segment = new byte[length];
+                input.readFully(segment);
+                parseExif(segment);
+            } else if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+                input.readUnsignedByte(); // precision
+                height = input.readUnsignedShort();
+                width = input.readUnsignedShort();
+                // SOF is the last segment needed.
+                return;
+            } else {
+                skipFully(input, length);
+            }
+        }
+    }
+
+    void parseExif(byte[] segment) {
+        if (segment.length < 14 || segment[0] != 'E' || segment[1] != 'x' || segment[2] != 'i' || segment[3] != 'f') {
+            return;
+        }
+        TiffReader tiff = new TiffReader(segment, 6);
+        if (!tiff.isValid()) {
+            return;
+        }
+
+        int ifd0 = tiff.readInt(4);
+        int entryCount = tiff.readShort(ifd0);
+        for (int i = 0; i < entryCount; i++) {
+            int entry = ifd0 + 2 + i * 12;
+            if (tiff.readShort(entry) == TAG_ORIENTATION) {
+                int value = tiff.readShort(entry + 8);
+                if (value >= 1 && value <= 8) {
+                    orientation = value;
+                }
+            }
+        }
+
+        // IFD1 describes the embedded thumbnail.
+        int ifd1 = tiff.readInt(ifd0 + 2 + entryCount * 12);
+        if (ifd1 <= 0) {
+            return;
+        }
+        int thumbnailOffset = 0;
+        int thumbnailLength = 0;
+        entryCount = tiff.readShort(ifd1);
+        for (int i = 0; i < entryCount; i++) {
+            int entry = ifd1 + 2 + i * 12;
+            int tag = tiff.readShort(entry);
+            if (tag == TAG_THUMBNAIL_OFFSET) {
+                thumbnailOffset = tiff.readInt(entry + 8);
+            } else if (tag == TAG_THUMBNAIL_LENGTH) {
+                thumbnailLength = tiff.readInt(entry + 8);
+            }
+        }
+        int start = 6 + thumbnailOffset;
+        if (thumbnailOffset > 0 && thumbnailLength > 2 && start + thumbnailLength <= segment.length
+                && (segment[start] & 0xFF) == 0xFF && (segment[start + 1] & 0xFF) == 0xD8) {
+            thumbnail = Arrays.copyOfRange(segment, start, start + thumbnailLength);
+        }
+    }
+
+    private static void skipFully(DataInputStream input, int count) throws IOException {
+        while (count > 0) {
+            int skipped = input.skipBytes(count);
+            if (skipped <= 0) {
+                throw new EOFException();
+            }
+            count -= skipped;
+        }
+    }
+
+    /**
+     * bounds checked reads from a TIFF structure, offsets relative to the TIFF header. Out of range reads return 0.
+     */
+    static class TiffReader {
+        private final byte[] data;
+        private final int base;
+        private final boolean littleEndian;
+
+        TiffReader(byte[] data, int base) {
+            this.data = data;
+            this.base = base;
+            this.littleEndian = data.length > base + 1 && data[base] == 'I' && data[base + 1] == 'I';
+        }
+
+        boolean isValid() {
+            return data.length >= base + 8
+                    && ((data[base] == 'I' && data[base + 1] == 'I') || (data[base] == 'M' && data[base + 1] == 'M'));
+        }
+
+        int readShort(int offset) {
+            int position = base + offset;
+            if (offset < 0 || position + 2 > data.length) {
+                return 0;
+            }
+            int b0 = data[position] & 0xFF;
+            int b1 = data[position + 1] & 0xFF;
+            return littleEndian ? (b1 << 8) | b0 : (b0 << 8) | b1;
+        }
+
+        int readInt(int offset) {
+            int position = base + offset;
+            if (offset < 0 || position + 4 > data.length) {
+                return 0;
+            }
+            int high = readShort(littleEndian ? offset + 2 : offset);
+            int low = readShort(littleEndian ? offset : offset + 2);
+            return (high << 16) | low;
+        }
+    }
+}
@@ -0,0 +1,567 @@
+/*
+ * Copyright (C) 2018 The OpenFlutter Organization
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.jarvan.fluwx.utils;
+
+import android.annotation.TargetApi;
+import android.content.Context;
+import android.content.res.AssetFileDescriptor;
+import android.content.res.AssetManager;
+import android.graphics.ImageDecoder;
+import android.net.Uri;
+import android.os.Build;
+import android.os.ParcelFileDescriptor;
+import android.util.Log;
+
+import com.jarvan.fluwx.constant.WeChatPluginImageSchema;
+import com.jarvan.fluwx.constant.WechatPluginKeys;
+
+import java.io.ByteArrayInputStream;
+import java.io.DataInputStream;
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileNotFoundException;
+import java.io.IOException;
+import java.io.InputStream;
+import java.nio.ByteBuffer;
+import java.nio.MappedByteBuffer;
+import java.nio.channels.FileChannel;
+
+import io.flutter.plugin.common.PluginRegistry;
+import okhttp3.CacheControl;
+import okhttp3.Request;
+import okhttp3.Response;
+import okhttp3.ResponseBody;
+import okio.Buffer;
+import okio.BufferedSource;
+import okio.HashingSource;
+import okio.Okio;
+
+/**
+ * Where an image comes from: assets://, file://, content:// or the network.
+ * A source can be opened more than once, so bounds and pixels are read in two passes
+ * straight from the origin, without copying it into a temp file first.
+ */
+public abstract class ImageSource {
+
+    private static final String TAG = "fluwx";
+    private static final long FETCH_SEGMENT_SIZE = 8192;
+
+    public abstract InputStream openStream() throws IOException;
+
+    @TargetApi(Build.VERSION_CODES.P)
+    public abstract ImageDecoder.Source createDecoderSource();
+
+    /**
+     * size of the encoded image in bytes, -1 if it can't be known without reading it.
+     */
+    public long length() {
+        return -1;
+    }
+
+    /**
+     * identifies the image for {@link ThumbnailCache}, null if thumbnails of it aren't cached.
+     */
+    public String cacheKey() {
+        return null;
+    }
+
+    /**
+     * SHA-256 of the image's bytes if they were hashed on the way in, null otherwise.
+     */
+    public String contentHash() {
+        return null;
+    }
+
+    /**
+     * changes whenever the image does, e.g. size and modification time of a file.
+     */
+    public String validator() {
+        return null;
+    }
+
+    /**
+     * time until which a thumbnail made from this image may be used without checking {@link #validator()}.
+     */
+    public long expiresAt() {
+        return 0;
+    }
+
+    /**
+     * @return true if a thumbnail made when the image had {@code validator} still shows the image.
+     */
+    public boolean isCurrent(String validator, long validUntil) {
+        return validator != null && validator.equals(validator());
+    }
+
+    /**
+     * reads straight into an array of {@link #length()} if that is known, otherwise into a pooled buffer
+     * that is trimmed to length once.
+     */
+    public byte[] readBytes() throws IOException {
+        long length = length();
+        InputStream inputStream = openStream();
+        try {
+            if (length >= 0 && length <= Integer.MAX_VALUE) {
+                byte[] bytes = new byte[(int) length];
+                new DataInputStream(inputStream).readFully(bytes);
+                return bytes;
+            }
+            PooledByteArrayOutputStream output = new PooledByteArrayOutputStream(0);
+            try {
+                output.readFrom(inputStream);
+                return output.toByteArray();
+            } finally {
+                output.close();
+            }
+        } finally {
+            inputStream.close();
+        }
+    }
+
+    /**
+     * @param maxFetchBytes a network image longer than this isn't downloaded, reading it throws
+     *                      {@link MediaTooLargeException}; one of the caps in {@link ThumbnailSpec}.
+     * @return null if the image can't be located. Network images are downloaded on first use.
+     */
+    public static ImageSource from(PluginRegistry.Registrar registrar, String path, long maxFetchBytes) {
+        if (path.startsWith(WeChatPluginImageSchema.SCHEMA_ASSETS)) {
+            int endIndex = path.length();
+            int indexOfPackage = path.indexOf(WechatPluginKeys.PACKAGE);
+            if (indexOfPackage > 0) {
+                endIndex = indexOfPackage;
+            }
+            String key = path.substring(WeChatPluginImageSchema.SCHEMA_ASSETS.length(), endIndex);
+            String assetPackage = null;
+            if (indexOfPackage > 0) {
+                assetPackage = path.substring(indexOfPackage + WechatPluginKeys.PACKAGE.length());
+            }
+            return new AssetSource(registrar, AssetManagerUtil.lookupKey(registrar, key, assetPackage));
+        } else if (path.startsWith(WeChatPluginImageSchema.SCHEMA_FILE)) {
+            return new FileSource(new File(path.substring(WeChatPluginImageSchema.SCHEMA_FILE.length())));
+        } else if (path.startsWith(WeChatPluginImageSchema.SCHEMA_CONTENT)) {
+            return new ContentSource(registrar.context().getApplicationContext(), Uri.parse(path));
+        } else {
+            return new NetworkSource(registrar.context().getApplicationContext(), path, maxFetchBytes);
+        }
+    }
+
+    /**
+     * {@code http(s)} URL, downloaded on first use. When a cached thumbnail exists it is revalidated
+     * with its ETag instead, so an unchanged image isn't downloaded again.
+     * <p>
+     * A body longer than {@code maxFetchBytes} is abandoned as soon as its Content-Length, or the count of
+     * bytes read so far if it has none, says so; the rest of it is never read.
+     */
+    public static class NetworkSource extends ImageSource {
+        private final Context context;
+        private final String url;
+        private final long maxFetchBytes;
+        private byte[] bytes;
+        private MediaTooLargeException tooLarge;
+        private String contentHash;
+        private String etag;
+        private long expiresAt;
+
+        NetworkSource(Context context, String url, long maxFetchBytes) {
+            this.context = context;
+            if (!url.startsWith("https") && !url.startsWith("http")) {
+                url = "http://" + url;
+            }
+            this.url = url;
+            this.maxFetchBytes = maxFetchBytes;
+        }
+
+        private synchronized byte[] bytes() throws IOException {
+            if (tooLarge != null) {
+                // the image and its thumbnail share a source; the second reader doesn't download it again.
+                throw tooLarge;
+            }
+            if (bytes == null) {
+                fetch(null);
+                if (bytes == null) {
+                    throw new IOException("downloading " + url + " failed");
+                }
+            }
+            return bytes;
+        }
+
+        /**
+         * @return true if the server answered 304 to {@code ifNoneMatch}; otherwise the image is downloaded.
+         */
+        private synchronized boolean fetch(String ifNoneMatch) {
+            Request.Builder builder = new Request.Builder().url(url).get();
+            if (ifNoneMatch != null) {
+                builder.header("If-None-Match", ifNoneMatch);
+            }
+            try {
+                return MediaFetcher.getInstance(context).fetch(builder.build(), new MediaFetcher.BodyReader<Boolean>() {
+                    @Override
+                    public Boolean read(Response response) throws IOException {
+                        CacheControl cacheControl = response.cacheControl();
+                        int maxAge = cacheControl.noCache() || cacheControl.noStore() ? -1 : cacheControl.maxAgeSeconds();
+                        expiresAt = maxAge > 0 ? System.currentTimeMillis() + maxAge * 1000L : 0;
+                        if (response.code() == 304) {
+                            return true;
+                        }
+                        ResponseBody responseBody = response.body();
+                        if (response.isSuccessful() && responseBody != null) {
+                            long contentLength = responseBody.contentLength();
+                            if (contentLength > maxFetchBytes) {
+                                throw tooLarge();
+                            }
+                            // hashed while it streams in, for deduplicating the same image served under another URL.
+                            HashingSource hashingSource = HashingSource.sha256(responseBody.source());
+                            BufferedSource bufferedSource = Okio.buffer(hashingSource);
+                            // nothing is kept until the body has been read whole: a truncated one leaves the source unfetched.
+                            byte[] body;
+                            if (contentLength >= 0 && contentLength <= Integer.MAX_VALUE) {
+                                // copied out segment by segment as it arrives, rather than buffered whole and copied at the end.
+                                body = new byte[(int) contentLength];
+                                bufferedSource.readFully(body);
+                            } else {
+                                body = readCapped(bufferedSource);
+                            }
+                            MediaStats.BYTES_COPIED.addAndGet(body.length);
+                            contentHash = hashingSource.hash().hex();
+                            etag = response.header("ETag");
+                            bytes = body;
+                        }
+                        return false;
+                    }
+                });
+            } catch (IOException e) {
+                Log.i(TAG, "downloading image failed:\n" + e.getMessage());
+            }
+            return false;
+        }
+
+        /**
+         * reads a body of unknown length, counting it a segment at a time against {@link #maxFetchBytes}.
+         */
+        private byte[] readCapped(BufferedSource bufferedSource) throws IOException {
+            Buffer buffer = new Buffer();
+            while (bufferedSource.read(buffer, FETCH_SEGMENT_SIZE) != -1) {
+                if (buffer.size() > maxFetchBytes) {
+                    throw tooLarge();
+                }
+            }
+            return buffer.readByteArray();
+        }
+
+        private MediaTooLargeException tooLarge() {
+            MediaStats.FETCHES_ABORTED.incrementAndGet();
+            tooLarge = new MediaTooLargeException(url, maxFetchBytes);
+            return tooLarge;
+        }
+
+        @Override
+        public InputStream openStream() throws IOException {
+            return new ByteArrayInputStream(bytes());
+        }
+
+        @TargetApi(Build.VERSION_CODES.P)
+        @Override
+        public ImageDecoder.Source createDecoderSource() {
+            try {
+                return ImageDecoder.createSource(ByteBuffer.wrap(bytes()));
+            } catch (IOException e) {
+                return ImageDecoder.createSource(ByteBuffer.allocate(0));
+            }
+        }
+
+        @Override
+        public long length() {
+            try {
+                return bytes().length;
+            } catch (IOException e) {
+                return -1;
+            }
+        }
+
+        @Override
+        public byte[] readBytes() throws IOException {
+            return bytes();
+        }
+
+        @Override
+        public String cacheKey() {
+            return url;
+        }
+
+        @Override
+        public String contentHash() {
+            try {
+                bytes();
+            } catch (IOException e) {
+                return null;
+            }
+            synchronized (this) {
+                return contentHash;
+            }
+        }
+
+        @Override
+        public synchronized String validator() {
+            return etag;
+        }
+
+        @Override
+        public synchronized long expiresAt() {
+            return expiresAt;
+        }
+
+        @Override
+        public synchronized boolean isCurrent(String validator, long validUntil) {
+            if (System.currentTimeMillis() < validUntil) {
+                return true;
+            }
+            if (bytes != null) {
+                // already downloaded for this share, compare with what was served instead of asking again.
+                return validator != null && validator.equals(etag);
+            }
+            if (validator == null || !fetch(validator)) {
+                return false;
+            }
+            etag = validator;
+            return true;
+        }
+    }
+
+    private static long lengthOf(AssetManager assetManager, String lookupKey) {
+        try {
+            AssetFileDescriptor fileDescriptor = assetManager.openFd(lookupKey);
+            long length = fileDescriptor.getLength();
+            fileDescriptor.close();
+            return length;
+        } catch (IOException e) {
+            return -1;
+        }
+    }
+
+    public static class BytesSource extends ImageSource {
+        private final byte[] bytes;
+
+        public BytesSource(byte[] bytes) {
+            this.bytes = bytes;
+        }
+
+        public byte[] getBytes() {
+            return bytes;
+        }
+
+        @Override
+        public long length() {
+            return bytes.length;
+        }
+
+        @Override
+        public byte[] readBytes() {
+            return bytes;
+        }
+
+        @Override
+        public InputStream openStream() {
+            return new ByteArrayInputStream(bytes);
+        }
+
+        @TargetApi(Build.VERSION_CODES.P)
+        @Override
+        public ImageDecoder.Source createDecoderSource() {
+            return ImageDecoder.createSource(ByteBuffer.wrap(bytes));
+        }
+    }
+
+    public static class FileSource extends ImageSource {
+        private final File file;
+
+        public FileSource(File file) {
+            this.file = file;
+        }
+
+        public File getFile() {
+            return file;
+        }
+
+        @Override
+        public InputStream openStream() throws IOException {
+            return new FileInputStream(file);
+        }
+
+        @Override
+        public long length() {
+            return file.isFile() ? file.length() : -1;
+        }
+
+        @Override
+        public String cacheKey() {
+            return file.toURI().toString();
+        }
+
+        @Override
+        public String validator() {
+            return file.isFile() ? file.length() + "@" + file.lastModified() : null;
+        }
+
+        @TargetApi(Build.VERSION_CODES.P)
+        @Override
+        public ImageDecoder.Source createDecoderSource() {
+            return ImageDecoder.createSource(file);
+        }
+    }
+
+    public static class AssetSource extends ImageSource {
+        private final PluginRegistry.Registrar registrar;
+        private final String lookupKey;
+
+        AssetSource(PluginRegistry.Registrar registrar, String lookupKey) {
+            this.registrar = registrar;
+            this.lookupKey = lookupKey;
+        }
+
+        @Override
+        public InputStream openStream() throws IOException {
+            try {
+                return registrar.context().getAssets().openFd(lookupKey).createInputStream();
+            } catch (FileNotFoundException e) {
+                // compressed in the APK, it can only be streamed.
+                return registrar.context().getAssets().open(lookupKey);
+            }
+        }
+
+        /**
+         * images are stored uncompressed in the APK, so the asset's range of it is mapped and copied out in one go.
+         */
+        @Override
+        public byte[] readBytes() throws IOException {
+            AssetFileDescriptor fileDescriptor;
+            try {
+                fileDescriptor = registrar.context().getAssets().openFd(lookupKey);
+            } catch (FileNotFoundException e) {
+                return super.readBytes();
+            }
+            FileInputStream inputStream = fileDescriptor.createInputStream();
+            try {
+                long length = fileDescriptor.getLength();
+                if (length < 0 || length > Integer.MAX_VALUE) {
+                    return super.readBytes();
+                }
+                MappedByteBuffer mapped = inputStream.getChannel()
+                        .map(FileChannel.MapMode.READ_ONLY, fileDescriptor.getStartOffset(), length);
+                byte[] bytes = new byte[(int) length];
+                mapped.get(bytes);
+                return bytes;
+            } finally {
+                inputStream.close();
+            }
+        }
+
+        @Override
+        public long length() {
+            return lengthOf(registrar.context().getAssets(), lookupKey);
+        }
+
+        @Override
+        public String cacheKey() {
+            return WeChatPluginImageSchema.SCHEMA_ASSETS + lookupKey;
+        }
+
+        /**
+         * assets only change with the app.
+         */
+        @Override
+        public String validator() {
+            return String.valueOf(AssetManagerUtil.appLastUpdateTime(registrar.context()));
+        }
+
+        @TargetApi(Build.VERSION_CODES.P)
+        @Override
+        public ImageDecoder.Source createDecoderSource() {
+            return ImageDecoder.createSource(registrar.context().getAssets(), lookupKey);
+        }
+    }
+
+    public static class ContentSource extends ImageSource {
+        private final Context context;
+        private final Uri uri;
+
+        ContentSource(Context context, Uri uri) {
+            this.context = context;
+            this.uri = uri;
+        }
+
+        @Override
+        public InputStream openStream() throws IOException {
+            InputStream inputStream = context.getContentResolver().openInputStream(uri);
+            if (inputStream == null) {
+                throw new IOException("can't open " + uri);
+            }
+            return inputStream;
+        }
+
+        public ParcelFileDescriptor openFileDescriptor() throws IOException {
+            ParcelFileDescriptor fileDescriptor = context.getContentResolver().openFileDescriptor(uri, "r");
+            if (fileDescriptor == null) {
+                throw new IOException("can't open " + uri);
+            }
+            return fileDescriptor;
+        }
+
+        /**
+         * reads through the provider's file descriptor straight into an array of the reported length.
+         */
+        @Override
+        public byte[] readBytes() throws IOException {
+            AssetFileDescriptor fileDescriptor = context.getContentResolver().openAssetFileDescriptor(uri, "r");
+            if (fileDescriptor == null) {
+                throw new IOException("can't open " + uri);
+            }
+            long length = fileDescriptor.getLength();
+            if (length < 0 || length > Integer.MAX_VALUE) {
+                fileDescriptor.close();
+                return super.readBytes();
+            }
+            DataInputStream input = new DataInputStream(fileDescriptor.createInputStream());
+            try {
+                byte[] bytes = new byte[(int) length];
+                input.readFully(bytes);
+                return bytes;
+            } finally {
+                input.close();
+            }
+        }
+
+        @Override
+        public long length() {
+            try {
+                AssetFileDescriptor fileDescriptor = context.getContentResolver().openAssetFileDescriptor(uri, "r");
+                if (fileDescriptor == null) {
+                    return -1;
+                }
+                long length = fileDescriptor.getLength();
+                fileDescriptor.close();
+                return length;
+            } catch (IOException | SecurityException e) {
+                return -1;
+            }
+        }
+
+        @TargetApi(Build.VERSION_CODES.P)
+        @Override
+        public ImageDecoder.Source createDecoderSource() {
+            return ImageDecoder.createSource(context.getContentResolver(), uri);
+        }
+    }
+}
@@ -0,0 +1,244 @@
+/*
+ * Copyright (C) 2018 The OpenFlutter Organization
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.jarvan.fluwx.utils;
+
+import android.graphics.Bitmap;
+import android.graphics.BitmapFactory;
+import android.graphics.BitmapRegionDecoder;
+import android.graphics.Canvas;
+import android.graphics.Paint;
+import android.graphics.Rect;
+import android.graphics.RectF;
+import android.os.Build;
+import android.os.ParcelFileDescriptor;
+import android.util.Log;
+
+import java.io.IOException;
+import java.io.InputStream;
+
+/**
+ * Downscales an image of any size into a byte budget with bounded memory.
+ * <p>
+ * The source is never decoded whole: {@link BitmapRegionDecoder} decodes it in horizontal bands,
+ * subsampled by the decoder, and each band is drawn scaled into the output bitmap and then decoded over.
+ * A band is drawn through the EXIF orientation, so a rotated image needs no second, rotated copy of the
+ * output. The output is then fitted into the byte budget by {@link ThumbnailSizeSolver}, which holds a
+ * resampled copy of it, no larger, an encode buffer and the encoded result next to it; Android has no
+ * incremental encoder. The output is sized so that both phases, output and band, then output and what the
+ * solver holds, fit the memory budget, so a 100 MP panorama takes as much memory as a photo. Only images
+ * without a region decoder, e.g. GIF, are decoded whole, subsampled, and may exceed it.
+ */
+public class ImageTranscoder {
+
+    private static final String TAG = "fluwx";
+
+    /**
+     * peak memory of the bitmaps and encoded data of a transcode unless the caller passes another budget.
+     */
+    public static final long DEFAULT_MEMORY_BUDGET = 48 * 1024 * 1024;
+
+    private ImageTranscoder() {
+    }
+
+    /**
+     * @param maxBytes     the encoded image is at most this long.
+     * @param memoryBudget bytes of bitmaps and encoded data the transcode may hold at once.
+     * @param format       PNG or JPEG to encode in, usually the source's own format. Null to pick from the
+     *                     decoded image: a PNG if it has alpha, a JPEG otherwise.
+     * @return null if the image can't be decoded or doesn't fit {@code maxBytes}.
+     */
+    public static byte[] transcode(ImageSource source, int maxBytes, long memoryBudget, Bitmap.CompressFormat format) throws IOException {
+        BitmapFactory.Options bounds = new BitmapFactory.Options();
+        bounds.inJustDecodeBounds = true;
+        ThumbnailCompressUtil.decodeStream(source, bounds);
+        int width = bounds.outWidth;
+        int height = bounds.outHeight;
+        if (width <= 0 || height <= 0) {
+            return null;
+        }
+
+        // while solving, the output sits next to a copy of at most its size and an encode buffer and result of at
+        // most its size or maxBytes each; while decoding, next to a band, which gets the rest.
+        long outputBudget = Math.max(memoryBudget / 4, (memoryBudget - 2L * maxBytes) / 2);
+        long bandBudget = memoryBudget - outputBudget;
+
+        // as many pixels as fit both the byte budget and the output's share of the memory budget.
+        boolean keepAlpha = format != Bitmap.CompressFormat.JPEG;
+        Bitmap.Config config = BitmapPool.configFor(!keepAlpha, true);
+        int bytesPerPixel = config == Bitmap.Config.RGB_565 ? 2 : 4;
+        long pixelCap = ThumbnailCore.pixelCap(maxBytes, ThumbnailCore.formatOf(keepAlpha));
+        double pixels = Math.min((double) width * height, Math.min(pixelCap, (double) outputBudget / bytesPerPixel));
+        double factor = Math.min(1, Math.sqrt(pixels / ((double) width * height)));
+        int targetWidth = Math.max(1, (int) (width * factor));
+        int targetHeight = Math.max(1, (int) (height * factor));
+
+        int orientation = readOrientation(source);
+        Bitmap bitmap = null;
+        try {
+            bitmap = decodeInBands(source, width, height, targetWidth, targetHeight, orientation, config, bandBudget);
+        } catch (IOException | IllegalArgumentException e) {
+            // no region decoder for this format, e.g. GIF.
+            Log.i(TAG, "decoding image in bands failed:\n" + e.getMessage());
+        }
+        if (bitmap == null) {
+            bitmap = decodeSampled(source, width, height, targetWidth, targetHeight, config);
+            if (bitmap == null) {
+                return null;
+            }
+            bitmap = ThumbnailCompressUtil.transform(bitmap, Integer.MAX_VALUE, orientation, true);
+        }
+
+        if (!keepAlpha) {
+            bitmap.setHasAlpha(false);
+        }
+        if (format == null) {
+            format = bitmap.hasAlpha() ? Bitmap.CompressFormat.PNG : Bitmap.CompressFormat.JPEG;
+        }
+        try {
+            return ThumbnailSizeSolver.solve(bitmap, maxBytes, format).data;
+        } finally {
+            BitmapPool.put(bitmap);
+        }
+    }
+
+    /**
+     * decodes full-width bands of as many rows as fit in {@code bandBudget} and draws them into a
+     * {@code targetWidth x targetHeight} bitmap with the EXIF {@code orientation} applied, so its sides are
+     * swapped for a quarter turn. Each band is decoded into the bitmap of the one before.
+     */
+    private static Bitmap decodeInBands(ImageSource source, int width, int height, int targetWidth, int targetHeight,
+                                        int orientation, Bitmap.Config config, long bandBudget) throws IOException {
+        int sampleSize = ThumbnailCompressUtil.computeInSampleSize(width, height, Math.max(targetWidth, targetHeight));
+        BitmapRegionDecoder decoder = newRegionDecoder(source);
+        if (decoder == null) {
+            return null;
+        }
+        BitmapFactory.Options options = new BitmapFactory.Options();
+        Bitmap output = null;
+        try {
+            options.inSampleSize = sampleSize;
+            options.inPreferredConfig = config;
+
+            int bytesPerPixel = config == Bitmap.Config.RGB_565 ? 2 : 4;
+            int sampledWidth = ThumbnailCompressUtil.ceilDivide(width, sampleSize);
+            long rowBytes = (long) sampledWidth * bytesPerPixel;
+            int bandHeight = (int) Math.min(height, Math.max(1, bandBudget / rowBytes) * sampleSize);
+            BitmapPool.prepareDecode(options, sampledWidth, ThumbnailCompressUtil.ceilDivide(bandHeight, sampleSize));
+
+            boolean swap = ThumbnailCompressUtil.swapsDimensions(orientation);
+            output = BitmapPool.get(swap ? targetHeight : targetWidth, swap ? targetWidth : targetHeight, config);
+            Canvas canvas = new Canvas(output);
+            // band rects stay in the coordinates of the unrotated target.
+            canvas.concat(ThumbnailCompressUtil.orientationMatrix(orientation, targetWidth, targetHeight));
+            Paint paint = new Paint(Paint.FILTER_BITMAP_FLAG);
+            double scale = (double) targetHeight / height;
+            Rect region = new Rect();
+            Rect decoded = new Rect();
+            RectF destination = new RectF();
+            for (int top = 0; top < height; top += bandHeight) {
+                int bottom = Math.min(height, top + bandHeight);
+                region.set(0, top, width, bottom);
+                Bitmap band = BitmapPool.decoded(decoder.decodeRegion(region, options), options);
+                if (band == null) {
+                    throw new IOException("region " + region + " could not be decoded");
+                }
+                // a band decoded into a larger bitmap may keep that bitmap's size.
+                decoded.set(0, 0, Math.min(band.getWidth(), sampledWidth),
+                        Math.min(band.getHeight(), ThumbnailCompressUtil.ceilDivide(bottom - top, sampleSize)));
+                destination.set(0, (float) (top * scale), targetWidth, (float) (bottom * scale));
+                canvas.drawBitmap(band, decoded, destination, paint);
+                if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.KITKAT) {
+                    options.inBitmap = band;
+                } else {
+                    band.recycle();
+                }
+            }
+            return output;
+        } catch (IOException | RuntimeException e) {
+            BitmapPool.put(output);
+            throw e;
+        } finally {
+            BitmapPool.put(options.inBitmap);
+            decoder.recycle();
+        }
+    }
+
+    /**
+     * opens the decoder on the file or descriptor where there is one, so the encoded image isn't buffered in memory.
+     */
+    private static BitmapRegionDecoder newRegionDecoder(ImageSource source) throws IOException {
+        if (source instanceof ImageSource.FileSource) {
+            return BitmapRegionDecoder.newInstance(((ImageSource.FileSource) source).getFile().getPath(), false);
+        }
+        if (source instanceof ImageSource.BytesSource) {
+            byte[] bytes = ((ImageSource.BytesSource) source).getBytes();
+            return BitmapRegionDecoder.newInstance(bytes, 0, bytes.length, false);
+        }
+        if (source instanceof ImageSource.ContentSource) {
+            ParcelFileDescriptor fileDescriptor = ((ImageSource.ContentSource) source).openFileDescriptor();
+            try {
+                return BitmapRegionDecoder.newInstance(fileDescriptor.getFileDescriptor(), false);
+            } finally {
+                fileDescriptor.close();
+            }
+        }
+        InputStream inputStream = source.openStream();
+        try {
+            return BitmapRegionDecoder.newInstance(inputStream, false);
+        } finally {
+            inputStream.close();
+        }
+    }
+
+    /**
+     * the whole image subsampled until it fits twice the target, then scaled to it.
+     */
+    private static Bitmap decodeSampled(ImageSource source, int width, int height, int targetWidth, int targetHeight,
+                                        Bitmap.Config config) {
+        BitmapFactory.Options options = new BitmapFactory.Options();
+        int sampleSize = ThumbnailCompressUtil.computeInSampleSize(width, height, Math.max(targetWidth, targetHeight));
+        options.inSampleSize = sampleSize;
+        options.inPreferredConfig = config;
+        try {
+            BitmapPool.prepareDecode(options, ThumbnailCompressUtil.ceilDivide(width, sampleSize), ThumbnailCompressUtil.ceilDivide(height, sampleSize));
+            Bitmap bitmap = BitmapPool.decoded(ThumbnailCompressUtil.decodeStream(source, options), options);
+            if (bitmap == null || (bitmap.getWidth() <= targetWidth && bitmap.getHeight() <= targetHeight)) {
+                return bitmap;
+            }
+            Bitmap scaled = ThumbnailCompressUtil.scale(bitmap, targetWidth, targetHeight, ThumbnailCore.FILTER_AREA);
+            BitmapPool.put(bitmap);
+            return scaled;
+        } catch (IOException e) {
+            Log.i(TAG, "decoding image failed:\n" + e.getMessage());
+        } catch (OutOfMemoryError e) {
+            Log.e(TAG, "decoding image failed: " + e.getMessage());
+        }
+        return null;
+    }
+
+    private static int readOrientation(ImageSource source) {
+        try {
+            InputStream inputStream = source.openStream();
+            try {
+                return ImageHeader.parse(inputStream).orientation;
+            } finally {
+                inputStream.close();
+            }
+        } catch (IOException e) {
+            return ImageHeader.ORIENTATION_NORMAL;
+        }
+    }
+}
@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2018 The OpenFlutter Organization
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.jarvan.fluwx.utils;
+
+import android.content.Context;
+import android.util.Log;
+
+import java.io.File;
+import java.io.IOException;
+import java.io.InterruptedIOException;
+import java.net.HttpURLConnection;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.Semaphore;
+import java.util.concurrent.TimeUnit;
+
+import okhttp3.Cache;
+import okhttp3.ConnectionPool;
+import okhttp3.HttpUrl;
+import okhttp3.OkHttpClient;
+import okhttp3.Protocol;
+import okhttp3.Request;
+import okhttp3.Response;
+
+/**
+ * The one HTTP client every download of share media goes through.
+ * <p>
+ * Connections are kept alive in a single pool, so the image and the thumbnail of a share, and the next
+ * share from the same CDN, reuse a connection and its TLS session. Over HTTP/2 concurrent requests to a
+ * host are multiplexed on one connection. Requests are synchronous, callers are off the main thread
+ * already, and at most {@link #MAX_REQUESTS_PER_HOST} of them run against one host at a time.
+ * <p>
+ * Responses are kept in an HTTP cache in the app's cache dir that honours Cache-Control: a fresh
+ * entry is used without a request, a stale one is revalidated with its ETag or Last-Modified, so an
+ * unchanged image costs a 304 instead of its body. Hits, revalidations, misses and the bytes they
+ * saved are counted in {@link MediaStats}.
+ * <p>
+ * Media hosts the app names at {@code registerApp} are warmed in the background: a HEAD request to each
+ * resolves it and leaves a connection, TLS session included, in the pool for the first share. Warmed
+ * connections idle out after {@link #KEEP_ALIVE_MINUTES} like any other.
+ */
+public class MediaFetcher {
+
+    private static final String TAG = "fluwx";
+    private static final long CONNECT_TIMEOUT_SECONDS = 10;
+    private static final long READ_TIMEOUT_SECONDS = 20;
+    private static final int MAX_IDLE_CONNECTIONS = 5;
+    private static final long KEEP_ALIVE_MINUTES = 5;
+    private static final String CACHE_DIRECTORY = "fluwx_http";
+    private static final long CACHE_SIZE = 50 * 1024 * 1024;
+    static final int MAX_REQUESTS_PER_HOST = 4;
+    private static final ExecutorService WARMER = Executors.newSingleThreadExecutor();
+
+    private static MediaFetcher instance;
+
+    private final OkHttpClient client;
+    private final Map<String, Semaphore> hostPermits = new HashMap<>();
+
+    /**
+     * reads the response of {@link #fetch}, streaming its body.
+     */
+    public interface BodyReader<T> {
+        T read(Response response) throws IOException;
+    }
+
+    /**
+     * @param cacheDirectory null for no cache.
+     */
+    MediaFetcher(File cacheDirectory) {
+        OkHttpClient.Builder builder = new OkHttpClient.Builder();
+        if (cacheDirectory != null) {
+            builder.cache(new Cache(cacheDirectory, CACHE_SIZE));
+        }
+        client = builder
+                .connectionPool(new ConnectionPool(MAX_IDLE_CONNECTIONS, KEEP_ALIVE_MINUTES, TimeUnit.MINUTES))
+                .protocols(Arrays.asList(Protocol.HTTP_2, Protocol.HTTP_1_1))
+                .connectTimeout(CONNECT_TIMEOUT_SECONDS, TimeUnit.SECONDS)
+                .readTimeout(READ_TIMEOUT_SECONDS, TimeUnit.SECONDS)
+                .build();
+    }
+
+    public static synchronized MediaFetcher getInstance(Context context) {
+        if (instance == null) {
+            instance = new MediaFetcher(new File(context.getApplicationContext().getCacheDir(), CACHE_DIRECTORY));
+        }
+        return instance;
+    }
+
+    /**
+     * runs {@code request} and hands the response to {@code reader}; the response is closed afterwards.
+     * Blocks while {@link #MAX_REQUESTS_PER_HOST} requests to the same host are running.
+     */
+    public <T> T fetch(Request request, BodyReader<T> reader) throws IOException {
+        Semaphore permit = permitOf(request.url().host());
+        try {
+            permit.acquire();
+        } catch (InterruptedException e) {
+            Thread.currentThread().interrupt();
+            throw new InterruptedIOException("interrupted waiting for " + request.url().host());
+        }
+        try {
+            Response response = client.newCall(request).execute();
+            try {
+                countCacheUse(request, response);
+                return reader.read(response);
+            } finally {
+                response.close();
+            }
+        } finally {
+            permit.release();
+        }
+    }
+
+    /**
+     * sets up a connection to each of {@code hosts} in the background. A host is a name such as
+     * {@code cdn.example.com}, warmed over HTTPS, or a URL, whose scheme and port are used.
+     */
+    public void prewarm(List<String> hosts) {
+        final List<String> copy = new ArrayList<>(hosts);
+        WARMER.execute(new Runnable() {
+            @Override
+            public void run() {
+                for (String host : copy) {
+                    warm(host);
+                }
+            }
+        });
+    }
+
+    private void warm(String host) {
+        HttpUrl url = host == null ? null : HttpUrl.parse(host.contains("://") ? host : "https://" + host);
+        if (url == null) {
+            Log.i(TAG, "can't warm media host " + host);
+            return;
+        }
+        // HEAD isn't cached, so it always goes to the network, and it has no body to drain before the
+        // connection returns to the pool. Whatever the status, the connection is set up.
+        Request request = new Request.Builder().url(url.resolve("/")).head().build();
+        try {
+            client.newCall(request).execute().close();
+            MediaStats.MEDIA_HOSTS_WARMED.incrementAndGet();
+        } catch (IOException e) {
+            Log.i(TAG, "warming " + host + " failed:\n" + e.getMessage());
+        }
+    }
+
+    /**
+     * a request the caller made conditional itself bypasses the cache and isn't counted. A stale entry
+     * revalidated with anything but a 304 has changed, its body came over the network: a miss.
+     */
+    private static void countCacheUse(Request request, Response response) {
+        if (request.header("If-None-Match") != null || request.header("If-Modified-Since") != null) {
+            return;
+        }
+        Response networkResponse = response.networkResponse();
+        if (response.cacheResponse() == null
+                || (networkResponse != null && networkResponse.code() != HttpURLConnection.HTTP_NOT_MODIFIED)) {
+            MediaStats.HTTP_CACHE_MISSES.incrementAndGet();
+            return;
+        }
+        if (networkResponse == null) {
+            MediaStats.HTTP_CACHE_HITS.incrementAndGet();
+        } else {
+            MediaStats.HTTP_CACHE_REVALIDATIONS.incrementAndGet();
+        }
+        if (response.body() != null) {
+            MediaStats.HTTP_CACHE_BYTES_SAVED.addAndGet(Math.max(0, response.body().contentLength()));
+        }
+    }
+
+    private synchronized Semaphore permitOf(String host) {
+        Semaphore permit = hostPermits.get(host);
+        if (permit == null) {
+            permit = new Semaphore(MAX_REQUESTS_PER_HOST, true);
+            hostPermits.put(host, permit);
+        }
+        return permit;
+    }
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2018 The OpenFlutter Organization
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.jarvan.fluwx.utils;
+
+import java.util.HashMap;
+import java.util.Map;
+import java.util.concurrent.atomic.AtomicBoolean;
+import java.util.concurrent.atomic.AtomicLong;
+
+/**
+ * Counters of the media pipeline since the process started, returned to Dart by {@code getMediaStats}.
+ * iOS keeps the same keys in MediaStats.m.
+ */
+public final class MediaStats {
+
+    /**
+     * a thumbnail was reused because another source had the same bytes.
+     */
+    public static final AtomicLong THUMBNAIL_DEDUP_HITS = new AtomicLong();
+    public static final AtomicLong THUMBNAIL_DEDUP_MISSES = new AtomicLong();
+
+    /**
+     * a shared image file was reused because an earlier share had the same bytes.
+     */
+    public static final AtomicLong IMAGE_DEDUP_HITS = new AtomicLong();
+    public static final AtomicLong IMAGE_DEDUP_MISSES = new AtomicLong();
+
+    /**
+     * shares with media, and bytes copied from one buffer to another while preparing them. Reading, decoding
+     * and encoding aren't copies; an array grown or trimmed to its exact length is.
+     */
+    public static final AtomicLong MEDIA_SHARES = new AtomicLong();
+    public static final AtomicLong BYTES_COPIED = new AtomicLong();
+
+    /**
+     * a decode target or resampled bitmap was taken from {@link BitmapPool}, or had to be allocated;
+     * bytes of bitmaps allocated by the pool and by decoders.
+     */
+    public static final AtomicLong BITMAP_POOL_HITS = new AtomicLong();
+    public static final AtomicLong BITMAP_POOL_MISSES = new AtomicLong();
+    public static final AtomicLong BITMAP_BYTES_ALLOCATED = new AtomicLong();
+
+    /**
+     * a download was served by the HTTP cache, revalidated with a 304, or went to the network; bytes of
+     * bodies served from the cache.
+     */
+    public static final AtomicLong HTTP_CACHE_HITS = new AtomicLong();
+    public static final AtomicLong HTTP_CACHE_REVALIDATIONS = new AtomicLong();
+    public static final AtomicLong HTTP_CACHE_MISSES = new AtomicLong();
+    public static final AtomicLong HTTP_CACHE_BYTES_SAVED = new AtomicLong();
+
+    /**
+     * a download was abandoned because its body was longer than the cap of what it was for.
+     */
+    public static final AtomicLong FETCHES_ABORTED = new AtomicLong();
+
+    /**
+     * media hosts passed to {@code registerApp} that a connection was set up to in advance.
+     */
+    public static final AtomicLong MEDIA_HOSTS_WARMED = new AtomicLong();
+
+    /**
+     * milliseconds the first share with media since launch took to prepare, once for a share that started after
+     * media hosts had been warmed and once for one that started before any was; 0 until there is such a share.
+     */
+    public static final AtomicLong FIRST_WARM_SHARE_MILLIS = new AtomicLong();
+    public static final AtomicLong FIRST_COLD_SHARE_MILLIS = new AtomicLong();
+
+    private static final AtomicBoolean firstWarmShareRecorded = new AtomicBoolean();
+    private static final AtomicBoolean firstColdShareRecorded = new AtomicBoolean();
+
+    /**
+     * thumbnails and transcodes fitted into a byte budget by {@link ThumbnailSizeSolver}, the encodes they took,
+     * how many needed the forced downscale after two encodes missed, and how many were dropped because even
+     * that was over the budget.
+     */
+    public static final AtomicLong SOLVER_RUNS = new AtomicLong();
+    public static final AtomicLong SOLVER_ENCODES = new AtomicLong();
+    public static final AtomicLong SOLVER_FORCED_DOWNSCALES = new AtomicLong();
+    public static final AtomicLong SOLVER_MISSES = new AtomicLong();
+
+    /**
+     * thumbnails sent without decoding: the source's own bytes, or the thumbnail embedded in its EXIF.
+     */
+    public static final AtomicLong THUMBNAIL_PASSTHROUGHS = new AtomicLong();
+    public static final AtomicLong THUMBNAIL_EMBEDDED = new AtomicLong();
+
+    private MediaStats() {
+    }
+
+    /**
+     * keeps the latency of the first warm and the first cold share only; later calls are ignored.
+     */
+    public static void recordFirstShare(long millis, boolean prewarmed) {
+        if (prewarmed) {
+            if (firstWarmShareRecorded.compareAndSet(false, true)) {
+                FIRST_WARM_SHARE_MILLIS.set(millis);
+            }
+        } else if (firstColdShareRecorded.compareAndSet(false, true)) {
+            FIRST_COLD_SHARE_MILLIS.set(millis);
+        }
+    }
+
+    public static Map<String, Long> snapshot() {
+        Map<String, Long> stats = new HashMap<>();
+        stats.put("solverRuns", SOLVER_RUNS.get());
+        stats.put("solverEncodes", SOLVER_ENCODES.get());
+        stats.put("solverForcedDownscales", SOLVER_FORCED_DOWNSCALES.get());
+        stats.put("solverMisses", SOLVER_MISSES.get());
+        stats.put("thumbnailPassthroughs", THUMBNAIL_PASSTHROUGHS.get());
+        stats.put("thumbnailEmbedded", THUMBNAIL_EMBEDDED.get());
+        stats.put("thumbnailDedupHits", THUMBNAIL_DEDUP_HITS.get());
+        stats.put("thumbnailDedupMisses", THUMBNAIL_DEDUP_MISSES.get());
+        stats.put("imageDedupHits", IMAGE_DEDUP_HITS.get());
+        stats.put("imageDedupMisses", IMAGE_DEDUP_MISSES.get());
+        stats.put("mediaShares", MEDIA_SHARES.get());
+        stats.put("bytesCopied", BYTES_COPIED.get());
+        stats.put("bitmapPoolHits", BITMAP_POOL_HITS.get());
+        stats.put("bitmapPoolMisses", BITMAP_POOL_MISSES.get());
+        stats.put("bitmapBytesAllocated", BITMAP_BYTES_ALLOCATED.get());
+        stats.put("httpCacheHits", HTTP_CACHE_HITS.get());
+        stats.put("httpCacheRevalidations", HTTP_CACHE_REVALIDATIONS.get());
+        stats.put("httpCacheMisses", HTTP_CACHE_MISSES.get());
+        stats.put("httpCacheBytesSaved", HTTP_CACHE_BYTES_SAVED.get());
+        stats.put("fetchesAborted", FETCHES_ABORTED.get());
+        stats.put("mediaHostsWarmed", MEDIA_HOSTS_WARMED.get());
+        stats.put("firstWarmShareMillis", FIRST_WARM_SHARE_MILLIS.get());
+        stats.put("firstColdShareMillis", FIRST_COLD_SHARE_MILLIS.get());
+        return stats;
+    }
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2018 The OpenFlutter Organization
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.jarvan.fluwx.utils;
+
+/**
+ * A download was abandoned because its body is longer than the cap of what it was fetched for.
+ * <p>
+ * Unchecked on purpose: the utils swallow {@link java.io.IOException}s and carry on without the image,
+ * while this has to reach the share handler, which fails the share with
+ * {@link com.jarvan.fluwx.constant.CallResult#RESULT_MEDIA_TOO_LARGE}.
+ */
+public class MediaTooLargeException extends RuntimeException {
+
+    private final String url;
+    private final long limit;
+
+    public MediaTooLargeException(String url, long limit) {
+        super(url + " is longer than " + limit + " bytes");
+        this.url = url;
+        this.limit = limit;
+    }
+
+    public String getUrl() {
+        return url;
+    }
+
+    public long getLimit() {
+        return limit;
+    }
+}
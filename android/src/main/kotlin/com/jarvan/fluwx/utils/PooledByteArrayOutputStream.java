@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2018 The OpenFlutter Organization
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.jarvan.fluwx.utils;
+
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.OutputStream;
+import java.util.Arrays;
+
+/**
+ * A {@link java.io.ByteArrayOutputStream} on a buffer from {@link ByteArrayPool}. The content can be
+ * measured with {@link #size()} without copying it, and {@link #toByteArray()} copies it only if the buffer
+ * isn't already of exactly that length. {@link #close()} returns the buffer to the pool.
+ * Copies made here are counted in {@link MediaStats#BYTES_COPIED}.
+ */
+public class PooledByteArrayOutputStream extends OutputStream {
+
+    private byte[] buffer;
+    private int count;
+
+    /**
+     * @param expectedSize a good guess saves growing the buffer.
+     */
+    public PooledByteArrayOutputStream(int expectedSize) {
+        buffer = ByteArrayPool.acquire(expectedSize);
+    }
+
+    @Override
+    public void write(int b) {
+        ensureCapacity(count + 1);
+        buffer[count++] = (byte) b;
+    }
+
+    @Override
+    public void write(byte[] b, int off, int len) {
+        ensureCapacity(count + len);
+        System.arraycopy(b, off, buffer, count, len);
+        count += len;
+    }
+
+    /**
+     * reads {@code inputStream} to its end straight into the buffer. The caller closes the stream.
+     */
+    public void readFrom(InputStream inputStream) throws IOException {
+        while (true) {
+            if (count == buffer.length) {
+                ensureCapacity(count + 1);
+            }
+            int read = inputStream.read(buffer, count, buffer.length - count);
+            if (read == -1) {
+                return;
+            }
+            count += read;
+        }
+    }
+
+    public int size() {
+        return count;
+    }
+
+    /**
+     * the content as an array of its exact length, which is what WeChat takes. If the buffer happens to be
+     * that long it is handed out as is, which ends the stream.
+     */
+    public byte[] toByteArray() {
+        if (count == buffer.length) {
+            byte[] result = buffer;
+            buffer = null;
+            return result;
+        }
+        MediaStats.BYTES_COPIED.addAndGet(count);
+        return Arrays.copyOf(buffer, count);
+    }
+
+    @Override
+    public void close() {
+        // null once handed out by toByteArray().
+        ByteArrayPool.release(buffer);
+        buffer = null;
+        count = 0;
+    }
+
+    private void ensureCapacity(int minCapacity) {
+        if (minCapacity <= buffer.length) {
+            return;
+        }
+        byte[] grown = ByteArrayPool.acquire(Math.max(minCapacity, buffer.length * 2));
+        System.arraycopy(buffer, 0, grown, 0, count);
+        MediaStats.BYTES_COPIED.addAndGet(count);
+        ByteArrayPool.release(buffer);
+        buffer = grown;
+    }
+}
@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2018 The OpenFlutter Organization
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.jarvan.fluwx.utils;
+
+import android.content.Context;
+import android.util.Log;
+
+import java.io.File;
+import java.io.IOException;
+import java.security.MessageDigest;
+import java.security.NoSuchAlgorithmException;
+import java.util.Arrays;
+import java.util.Comparator;
+import java.util.HashMap;
+import java.util.Map;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+
+import okio.BufferedSink;
+import okio.ByteString;
+import okio.Okio;
+
+/**
+ * Files handed to WeChat by path, kept in one directory of the external cache under a size quota.
+ * <p>
+ * A file is named after the SHA-256 of its bytes, so sharing the same image again reuses it. A file is
+ * held while a share uses it and for {@link #READ_WINDOW} after it is released, because WeChat reads it
+ * after {@code sendReq} has returned. Only files nobody holds are evicted, least recently used first.
+ * Temp files of an earlier process are swept from the directory once, in the background, when the instance
+ * is created; nothing outside it is touched.
+ */
+public class ScratchFiles {
+
+    private static final String TAG = "fluwx";
+    private static final String DIRECTORY = "fluwx_share";
+    private static final String TEMP_SUFFIX = ".tmp";
+    private static final long QUOTA = 50 * 1024 * 1024;
+    private static final ExecutorService SWEEPER = Executors.newSingleThreadExecutor();
+
+    /**
+     * how long WeChat may take to read a file after the share that used it released it.
+     */
+    static final long READ_WINDOW = 10 * 60 * 1000;
+
+    private static ScratchFiles instance;
+
+    private final File directory;
+    private final Map<String, Integer> references = new HashMap<>();
+    private final Map<String, Long> heldUntil = new HashMap<>();
+
+    private ScratchFiles(File externalCacheDir) {
+        this.directory = externalCacheDir == null ? null : new File(externalCacheDir, DIRECTORY);
+    }
+
+    public static synchronized ScratchFiles getInstance(Context context) {
+        if (instance == null) {
+            Context applicationContext = context.getApplicationContext();
+            instance = new ScratchFiles(applicationContext.getExternalCacheDir());
+            SWEEPER.execute(new Runnable() {
+                @Override
+                public void run() {
+                    instance.sweep();
+                }
+            });
+        }
+        return instance;
+    }
+
+    /**
+     * writes {@code bytes} to a scratch file, or reuses the one an earlier share wrote with the same bytes,
+     * and holds it until {@link #release(File)}.
+     *
+     * @return null if there is no external cache or writing fails.
+     */
+    public synchronized File acquire(byte[] bytes, String suffix) {
+        if (directory == null || (!directory.isDirectory() && !directory.mkdirs())) {
+            return null;
+        }
+
+        // digested in place: ByteString.of would copy the image once more.
+        MessageDigest digest;
+        try {
+            digest = MessageDigest.getInstance("SHA-256");
+        } catch (NoSuchAlgorithmException e) {
+            Log.i(TAG, "hashing shared image failed:\n" + e.getMessage());
+            return null;
+        }
+        File file = new File(directory, ByteString.of(digest.digest(bytes)).hex() + suffix);
+        if (file.isFile() && file.length() == bytes.length) {
+            MediaStats.IMAGE_DEDUP_HITS.incrementAndGet();
+            file.setLastModified(System.currentTimeMillis());
+        } else {
+            MediaStats.IMAGE_DEDUP_MISSES.incrementAndGet();
+            if (!write(file, bytes)) {
+                return null;
+            }
+        }
+
+        Integer count = references.get(file.getName());
+        references.put(file.getName(), count == null ? 1 : count + 1);
+        trim();
+        return file;
+    }
+
+    /**
+     * the share is done with {@code file}; it stays readable for {@link #READ_WINDOW}.
+     */
+    public synchronized void release(File file) {
+        String name = file.getName();
+        Integer count = references.get(name);
+        if (count == null) {
+            return;
+        }
+        if (count <= 1) {
+            references.remove(name);
+        } else {
+            references.put(name, count - 1);
+        }
+        heldUntil.put(name, System.currentTimeMillis() + READ_WINDOW);
+    }
+
+    // written aside and renamed, so a file with the final name is always complete.
+    private static boolean write(File file, byte[] bytes) {
+        File temp = new File(file.getPath() + TEMP_SUFFIX);
+        BufferedSink sink = null;
+        try {
+            sink = Okio.buffer(Okio.sink(temp));
+            sink.write(bytes);
+            sink.close();
+            sink = null;
+            if (!temp.renameTo(file)) {
+                temp.delete();
+                return false;
+            }
+            return true;
+        } catch (IOException e) {
+            Log.i(TAG, "writing shared image failed:\n" + e.getMessage());
+            temp.delete();
+            return false;
+        } finally {
+            if (sink != null) {
+                try {
+                    sink.close();
+                } catch (IOException ignored) {
+                }
+            }
+        }
+    }
+
+    private boolean isHeld(String name, long now) {
+        if (references.containsKey(name)) {
+            return true;
+        }
+        Long until = heldUntil.get(name);
+        if (until == null) {
+            return false;
+        }
+        if (now < until) {
+            return true;
+        }
+        heldUntil.remove(name);
+        return false;
+    }
+
+    /**
+     * evicts files nobody holds, least recently used first, until the directory is within its quota.
+     */
+    private void trim() {
+        File[] files = directory.listFiles();
+        if (files == null) {
+            return;
+        }
+        long total = 0;
+        for (File file : files) {
+            total += file.length();
+        }
+        if (total <= QUOTA) {
+            return;
+        }
+
+        final Map<File, Long> lastModified = new HashMap<>();
+        for (File file : files) {
+            lastModified.put(file, file.lastModified());
+        }
+        Arrays.sort(files, new Comparator<File>() {
+            @Override
+            public int compare(File a, File b) {
+                long difference = lastModified.get(a) - lastModified.get(b);
+                return difference < 0 ? -1 : (difference > 0 ? 1 : 0);
+            }
+        });
+
+        long now = System.currentTimeMillis();
+        for (File file : files) {
+            if (total <= QUOTA) {
+                break;
+            }
+            if (isHeld(file.getName(), now)) {
+                continue;
+            }
+            long length = file.length();
+            if (file.delete()) {
+                total -= length;
+            }
+        }
+    }
+
+    /**
+     * deletes temp files of writes that never finished.
+     */
+    private synchronized void sweep() {
+        File[] files = directory == null ? null : directory.listFiles();
+        if (files == null) {
+            return;
+        }
+        for (File file : files) {
+            if (file.getName().endsWith(TEMP_SUFFIX)) {
+                file.delete();
+            }
+        }
+        trim();
+    }
+}
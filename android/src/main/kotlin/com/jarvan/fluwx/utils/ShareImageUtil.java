@@ -15,225 +15,115 @@
  */
 package com.jarvan.fluwx.utils;
 
-import android.content.ContentResolver;
-import android.content.Context;
-import android.content.res.AssetFileDescriptor;
-import android.database.Cursor;
 import android.graphics.Bitmap;
-import android.graphics.BitmapFactory;
-import android.net.Uri;
-import android.os.Build;
-import android.provider.MediaStore;
-import android.text.TextUtils;
 import android.util.Log;
 
-import com.jarvan.fluwx.constant.WeChatPluginImageSchema;
-import com.jarvan.fluwx.constant.WechatPluginKeys;
-
-import java.io.ByteArrayInputStream;
-import java.io.File;
-import java.io.FileInputStream;
-import java.io.FileOutputStream;
 import java.io.IOException;
 import java.io.InputStream;
-import java.io.OutputStream;
-import java.util.UUID;
 
 import io.flutter.plugin.common.PluginRegistry;
-import okhttp3.OkHttpClient;
-import okhttp3.Request;
-import okhttp3.Response;
-import okhttp3.ResponseBody;
-import okio.BufferedSink;
-import okio.Okio;
-import okio.Source;
 
 public class ShareImageUtil {
 
     final static int WX_MAX_IMAGE_BYTE_SIZE = 10485760;
 
-    public static byte[] getImageData(PluginRegistry.Registrar registrar, String path) {
-        byte[] result = null;
-        if (path.startsWith(WeChatPluginImageSchema.SCHEMA_ASSETS)) {
-            String key = path.substring(WeChatPluginImageSchema.SCHEMA_ASSETS.length());
-            AssetFileDescriptor fileDescriptor = AssetManagerUtil.openAsset(registrar, key, getPackage(key));
-            try {
-                InputStream inputStream = fileDescriptor.createInputStream();
-                result = streamToByteArray(inputStream);
-            } catch (IOException e) {
-                e.printStackTrace();
-            }
+    private static final String TAG = "fluwx";
 
-        } else if (path.startsWith(WeChatPluginImageSchema.SCHEMA_FILE)) {
-            String pathWithoutUri = path.substring("file://".length());
-            result = fileToByteArray(registrar, pathWithoutUri);
-        } else if (path.startsWith(WeChatPluginImageSchema.SCHEMA_CONTENT)) {
-            File file = getFileFromContentProvider(registrar, path);
-            if (file != null) {
-                result = fileToByteArray(registrar, file.getAbsolutePath());
-            }
-        } else {
-//            result = handleNetworkImage(registrar, path);
-            result = Util.inputStreamToByte(openStream(path));
-        }
-
-        return result;
-    }
+    /**
+     * memory of bitmaps and encoded data a transcode may use, whatever the size of the image.
+     */
+    public static long TRANSCODE_MEMORY_BUDGET = ImageTranscoder.DEFAULT_MEMORY_BUDGET;
 
-
-    private static byte[] streamToByteArray(InputStream inputStream) {
-        Bitmap bmp = null;
-        bmp = BitmapFactory.decodeStream(inputStream);
-        return Util.bmpToByteArray(bmp, true);
-    }
-
-    private static byte[] fileToByteArray(File file) {
-        Bitmap bmp = null;
-        bmp = BitmapFactory.decodeFile(file.getAbsolutePath());
-        return Util.bmpToByteArray(bmp, true);
+    public static byte[] getImageData(PluginRegistry.Registrar registrar, String path) {
+        return getImageData(registrar, path, null);
     }
 
-    private static byte[] fileToByteArray(PluginRegistry.Registrar registrar, String pathWithoutUri) {
-
-        byte[] result = null;
-        Bitmap bmp = null;
-        bmp = BitmapFactory.decodeFile(pathWithoutUri);
-
-        int byteCount;
-        if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.KITKAT) {
-            byteCount = bmp.getAllocationByteCount();
-        } else {
-            byteCount = bmp.getByteCount();
+    /**
+     * the image's own bytes if WeChat takes them as they are: a JPEG, PNG or GIF within its size limit.
+     * Other images, and images over the limit, are downscaled and encoded again.
+     *
+     * @param source {@link ImageSource#from} of {@code path}, or null. A network image is downloaded through it,
+     *               so a thumbnail made from the same source afterwards uses the downloaded bytes.
+     */
+    public static byte[] getImageData(PluginRegistry.Registrar registrar, String path, ImageSource source) {
+        if (source == null) {
+            source = ImageSource.from(registrar, path, ThumbnailSpec.MAX_IMAGE_FETCH_BYTES);
         }
-        if (byteCount >= WX_MAX_IMAGE_BYTE_SIZE) {
-            result = Util.bmpToCompressedByteArray(bmp, Bitmap.CompressFormat.JPEG, true);
-        } else {
-            result = Util.bmpToByteArray(bmp, true);
+        try {
+            long length = source.length();
+            if (length > WX_MAX_IMAGE_BYTE_SIZE) {
+                return transcode(source, shareableSuffixOf(readHead(source)));
+            }
+            byte[] original = source.readBytes();
+            String suffix = shareableSuffixOf(original);
+            if (suffix != null && original.length <= WX_MAX_IMAGE_BYTE_SIZE) {
+                return original;
+            }
+            return transcode(new ImageSource.BytesSource(original), suffix);
+        } catch (IOException | SecurityException e) {
+            Log.i(TAG, "reading image failed:\n" + e.getMessage());
+            return null;
         }
-
-        return result;
     }
 
-    private static String getPackage(String assetsName) {
-        String packageStr = null;
-        if (assetsName.contains(WechatPluginKeys.PACKAGE)) {
-            int index = assetsName.indexOf(WechatPluginKeys.PACKAGE);
-            packageStr = assetsName.substring(index + WechatPluginKeys.PACKAGE.length(), assetsName.length());
+    /**
+     * downscales {@code source} into WeChat's size limit within {@link #TRANSCODE_MEMORY_BUDGET}. A JPEG stays
+     * a JPEG and a PNG stays a PNG, opaque or not; any other image becomes a PNG if it has alpha and a JPEG otherwise.
+     */
+    private static byte[] transcode(ImageSource source, String suffix) throws IOException {
+        Bitmap.CompressFormat format = null;
+        if (".jpg".equals(suffix)) {
+            format = Bitmap.CompressFormat.JPEG;
+        } else if (".png".equals(suffix)) {
+            format = Bitmap.CompressFormat.PNG;
         }
-        return packageStr;
+        return ImageTranscoder.transcode(source, WX_MAX_IMAGE_BYTE_SIZE, TRANSCODE_MEMORY_BUDGET, format);
     }
 
-    public static File inputStreamToFile(InputStream inputStream, String suffix, Context context) {
-
-        File file = null;
-
-        BufferedSink sink = null;
-        Source source = null;
-        OutputStream outputStream = null;
+    private static byte[] readHead(ImageSource source) throws IOException {
+        InputStream inputStream = source.openStream();
         try {
-
-            File externalFile = context.getExternalCacheDir();
-            if (externalFile == null) {
-                return  null;
-            }
-            file  =  new File(externalFile.getAbsolutePath()+File.separator+UUID.randomUUID().toString()+suffix);
-
-
-//            file = File.createTempFile(UUID.randomUUID().toString(), suffix);
-            outputStream = new FileOutputStream(file);
-            sink = Okio.buffer(Okio.sink(outputStream));
-            source = Okio.source(inputStream);
-            sink.writeAll(source);
-            sink.flush();
-        } catch (IOException e) {
-            e.printStackTrace();
-        } finally {
-            if (sink != null) {
-                try {
-                    sink.close();
-                } catch (IOException e) {
-                    e.printStackTrace();
-                }
-            }
-
-            if (source != null) {
-                try {
-                    source.close();
-                } catch (IOException e) {
-                    e.printStackTrace();
-                }
-            }
-
-            if (outputStream != null) {
-                try {
-                    outputStream.close();
-                } catch (IOException e) {
-                    e.printStackTrace();
+            byte[] head = new byte[4];
+            int read = 0;
+            while (read < head.length) {
+                int count = inputStream.read(head, read, head.length - read);
+                if (count == -1) {
+                    break;
                 }
+                read += count;
             }
+            return head;
+        } finally {
+            inputStream.close();
         }
-
-        return file;
     }
 
-
-
-
-    private static InputStream openStream(String url) {
-        if(!url.startsWith("https") && !url.startsWith("http")){
-            url = "http://"+url;
+    /**
+     * ".jpg", ".png" or ".gif" if {@code head} starts like an image WeChat takes as it is, null otherwise.
+     */
+    private static String shareableSuffixOf(byte[] head) {
+        if (head.length >= 3 && head[0] == 'G' && head[1] == 'I' && head[2] == 'F') {
+            return ".gif";
         }
-        OkHttpClient okHttpClient = new OkHttpClient.Builder().build();
-        Request request = new Request.Builder().url(url).get().build();
-        try {
-            Response response = okHttpClient.newCall(request).execute();
-            ResponseBody responseBody = response.body();
-            if (response.isSuccessful() && responseBody != null) {
-                return responseBody.byteStream();
-            } else {
-                return null;
-            }
-
-        } catch (IOException e) {
-            e.printStackTrace();
-            return null;
+        if (head.length >= 2 && (head[0] & 0xFF) == 0xFF && (head[1] & 0xFF) == 0xD8) {
+            return ".jpg";
         }
-
+        if (head.length >= 4 && (head[0] & 0xFF) == 0x89 && head[1] == 'P' && head[2] == 'N' && head[3] == 'G') {
+            return ".png";
+        }
+        return null;
     }
 
-    private static File getFileFromContentProvider(PluginRegistry.Registrar registrar, String path) {
-        Source source = null;
-        BufferedSink sink = null;
-
-        File file = null;
-        try {
-            Context context = registrar.context().getApplicationContext();
-            Uri uri = Uri.parse(path);
-            String suffix = null;
-            String mimeType = context.getContentResolver().getType(uri);
-            if (TextUtils.equals(mimeType, "image/jpeg") || TextUtils.equals(mimeType, "image/jpg")) {
-                suffix = ".jpg";
-            } else if (TextUtils.equals(mimeType, "image/png")) {
-                suffix = ".png";
-            }
-
-
-            file = File.createTempFile(UUID.randomUUID().toString(), suffix);
-            InputStream inputStream = context.getContentResolver().openInputStream(uri);
-
-            if (inputStream == null) {
-                return null;
-            }
-            OutputStream outputStream = new FileOutputStream(file);
-            sink = Okio.buffer(Okio.sink(outputStream));
-            source = Okio.source(inputStream);
-            sink.writeAll(source);
-            source.close();
-            sink.close();
-        } catch (IOException e) {
-            Log.i("fluwx", "reading image failed:\n" + e.getMessage());
+    /**
+     * file suffix for {@code bytes}, from their format rather than {@code path}: a content URI has no extension.
+     */
+    public static String suffixOf(byte[] bytes, String path) {
+        String suffix = shareableSuffixOf(bytes);
+        if (suffix != null) {
+            return suffix;
         }
-
-        return file;
+        String name = path == null ? "" : path.substring(path.lastIndexOf('/') + 1);
+        int indexOfDot = name.lastIndexOf('.');
+        return indexOfDot == -1 ? ".jpeg" : name.substring(indexOfDot);
     }
 }
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2018 The OpenFlutter Organization
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.jarvan.fluwx.utils;
+
+import android.content.Context;
+import android.util.LruCache;
+
+import java.io.File;
+import java.nio.ByteBuffer;
+
+/**
+ * Encoded thumbnails, keyed by image and byte budget: a memory LRU in front of a bounded
+ * {@link ThumbnailPackFile} in the app's cache dir. Each entry keeps the validator of the image
+ * it was made from, see {@link ImageSource#isCurrent(String, long)}.
+ */
+public class ThumbnailCache {
+
+    private static final String PACK_FILE = "fluwx_thumbnails.pack";
+    private static final int MEMORY_CACHE_SIZE = 4 * 1024 * 1024;
+    private static final long DISK_CACHE_SIZE = 20 * 1024 * 1024;
+
+    private static ThumbnailCache instance;
+
+    public static class Entry {
+        public final String validator;
+        public final long expiresAt;
+        public final byte[] data;
+
+        Entry(String validator, long expiresAt, byte[] data) {
+            this.validator = validator;
+            this.expiresAt = expiresAt;
+            this.data = data;
+        }
+    }
+
+    private final LruCache<String, Entry> memoryCache = new LruCache<String, Entry>(MEMORY_CACHE_SIZE) {
+        @Override
+        protected int sizeOf(String key, Entry value) {
+            return value.data.length;
+        }
+    };
+    private final ThumbnailPackFile packFile;
+
+    private ThumbnailCache(File file) {
+        this.packFile = new ThumbnailPackFile(file, DISK_CACHE_SIZE);
+    }
+
+    public static synchronized ThumbnailCache getInstance(Context context) {
+        if (instance == null) {
+            instance = new ThumbnailCache(new File(context.getApplicationContext().getCacheDir(), PACK_FILE));
+        }
+        return instance;
+    }
+
+    /**
+     * @param embedded whether the thumbnail may be the image's EXIF one; such a thumbnail differs from
+     *                 the one decoded from the same image at the same budget, so the two are kept apart.
+     */
+    public static String key(String imageKey, int maxBytes, boolean embedded) {
+        return imageKey + "@" + maxBytes + (embedded ? "/embedded" : "/decoded");
+    }
+
+    /**
+     * @return null if nothing is cached for {@code key}. Validating the entry is up to the caller.
+     */
+    public Entry get(String key) {
+        Entry entry = memoryCache.get(key);
+        if (entry != null) {
+            return entry;
+        }
+        ThumbnailPackFile.Record[] record = new ThumbnailPackFile.Record[1];
+        ByteBuffer slice = packFile.get(key, record);
+        if (slice == null) {
+            return null;
+        }
+        // the slice is read straight from the mapping; WeChat wants a byte[], so this is the only copy.
+        byte[] data = new byte[slice.remaining()];
+        slice.get(data);
+        entry = new Entry(record[0].validator, record[0].expiresAt, data);
+        memoryCache.put(key, entry);
+        return entry;
+    }
+
+    public void put(String key, String validator, long expiresAt, byte[] data) {
+        if (data == null || data.length == 0) {
+            return;
+        }
+        Entry entry = new Entry(validator, expiresAt, data);
+        memoryCache.put(key, entry);
+        packFile.put(key, validator, expiresAt, data);
+    }
+}
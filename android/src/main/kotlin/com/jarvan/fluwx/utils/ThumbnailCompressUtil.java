@@ -15,15 +15,27 @@
  */
 package com.jarvan.fluwx.utils;
 
+import android.annotation.TargetApi;
 import android.graphics.Bitmap;
 import android.graphics.BitmapFactory;
+import android.graphics.Canvas;
+import android.graphics.ImageDecoder;
+import android.graphics.Matrix;
+import android.graphics.Paint;
+import android.graphics.Rect;
+import android.graphics.RectF;
+import android.os.Build;
 import android.util.Log;
+import android.util.Size;
 
 import java.io.ByteArrayOutputStream;
 import java.io.IOException;
+import java.io.InputStream;
 
 public class ThumbnailCompressUtil {
 
+    private static final String MIME_JPEG = "image/jpeg";
+
     /*** 图片压缩比例计算**
      * @param options BitmapFactory.Options* @param minSideLength 小边长，单位为像素，如果为-1，则不按照边来压缩图片*
      * @param maxNumOfPixels 这张片图片最大像素值，单位为byte，如100*1024* @return 压缩比例,必须为2的次幂*/
@@ -62,139 +74,246 @@ public class ThumbnailCompressUtil {
         }
     }
 
-    public static Bitmap makeNormalBitmap(String nativeImagePath, int minSideLength, int maxNumOfPixels) {
-        return makeNormalBitmap(nativeImagePath, minSideLength, maxNumOfPixels, Bitmap.Config.ARGB_4444);
-    }
+    /**
+     * Decodes {@code source} so that its longest edge is at most {@code maxPixelSize}.
+     * Bounds are read first and the decoder subsamples while decoding, so the full-size
+     * bitmap is never allocated. On P and above ImageDecoder decodes straight to the target size.
+     *
+     * @return null if the source can't be decoded.
+     */
+    public static Bitmap decodeSampledBitmap(ImageSource source, int maxPixelSize) {
+        try {
+            if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.P) {
+                return decodeWithImageDecoder(source, maxPixelSize);
+            }
 
-    public static Bitmap makeNormalBitmap(String nativeImagePath, int minSideLength, int maxNumOfPixels, Bitmap.Config config) {
-        Bitmap.CompressFormat format = Bitmap.CompressFormat.JPEG;
-        if (nativeImagePath.toLowerCase().endsWith(".png")) {
-            format = Bitmap.CompressFormat.PNG;
-        }
-//        ByteArrayOutputStream baos = new ByteArrayOutputStream();
-//        Bitmap bitmap = BitmapFactory.decodeFile(nativeImagePath);
-//        BitmapFactory.Options options = new BitmapFactory.Options();
-//        options.inPreferredConfig = config;
-//        options.outHeight = bitmap.getHeight();
-//        options.outWidth = bitmap.getWidth();
-//        int quality = computeSampleSize(options, minSideLength, maxNumOfPixels);
-//        bitmap.compress(format, quality, baos);
-//
-//        byte[] bytes = baos.toByteArray();
-//        bitmap.recycle();
-//        Bitmap result = BitmapFactory.decodeByteArray(bytes, 0, bytes.length, null);
-//        try {
-//            baos.close();
-//        } catch (IOException e) {
-//            e.printStackTrace();
-//        }
-        ByteArrayOutputStream baos = new ByteArrayOutputStream();
-        //质量压缩方法，这里100表示不压缩，把压缩后的数据存放到baos中
-        Bitmap bitmap = BitmapFactory.decodeFile(nativeImagePath);
-        bitmap.compress(Bitmap.CompressFormat.JPEG, 100, baos);
-        int options = 100; //此处可尝试用90%开始压缩，跳过100%压缩
-        // 循环判断如果压缩后图片是否大于100kb,大于继续压缩
-        int length;
-        while ((length = baos.toByteArray().length) / 1024 > 32) {
-            // 每次都减少10
-            options -= 10;
-
-            // 重置baos即清空baos
-            baos.reset();
-            // 这里压缩options%，把压缩后的数据存放到baos中
-            if (options <= 0) {
-                options = 0;
+            // JPEG and PNG bounds come from the header parser, which also reports the
+            // EXIF orientation BitmapFactory ignores; other formats fall back to a bounds decode.
+            ImageHeader header = readHeader(source);
+            BitmapFactory.Options options = new BitmapFactory.Options();
+            if (header.hasSize()) {
+                options.outWidth = header.width;
+                options.outHeight = header.height;
+            } else {
+                options.inJustDecodeBounds = true;
+                decodeStream(source, options);
+                if (options.outWidth <= 0 || options.outHeight <= 0) {
+                    return null;
+                }
             }
-            bitmap.compress(Bitmap.CompressFormat.JPEG, options, baos);
 
-            if (options == 0) {
-                break;
+            int sampleSize = computeInSampleSize(options.outWidth, options.outHeight, maxPixelSize);
+            options.inSampleSize = sampleSize;
+            options.inJustDecodeBounds = false;
+            // a JPEG is opaque and the thumbnail of an opaque image is a JPEG.
+            options.inPreferredConfig = BitmapPool.configFor(header.format == ImageHeader.FORMAT_JPEG, true);
+            BitmapPool.prepareDecode(options, ceilDivide(options.outWidth, sampleSize), ceilDivide(options.outHeight, sampleSize));
+            Bitmap bitmap = BitmapPool.decoded(decodeStream(source, options), options);
+            if (bitmap == null) {
+                return null;
             }
+            return transform(bitmap, maxPixelSize, header.orientation, true);
+        } catch (IOException e) {
+            Log.i("fluwx", "decoding image failed:\n" + e.getMessage());
+        } catch (OutOfMemoryError e) {
+            Log.e("fluwx", "decoding image failed: " + e.getMessage());
+        }
+        return null;
+    }
 
+    /**
+     * the largest power of two that keeps the longest edge at or above {@code maxPixelSize}.
+     * For JPEG, 2, 4 and 8 are done by the decoder's scaled IDCT, so a 4000x3000 photo decodes
+     * as 500x375 directly; larger factors scale by 1/8 in the IDCT and skip pixels for the rest.
+     */
+    static int computeInSampleSize(int width, int height, int maxPixelSize) {
+        int longest = Math.max(width, height);
+        int sampleSize = 1;
+        while (longest / (sampleSize * 2) >= maxPixelSize) {
+            sampleSize *= 2;
         }
+        return sampleSize;
+    }
 
+    private static ImageHeader readHeader(ImageSource source) throws IOException {
+        InputStream inputStream = source.openStream();
+        try {
+            return ImageHeader.parse(inputStream);
+        } finally {
+            inputStream.close();
+        }
+    }
 
-        return bitmap;
+    static int ceilDivide(int dimension, int sampleSize) {
+        return (dimension + sampleSize - 1) / sampleSize;
     }
 
-    public static Bitmap compress(String nativeImagePath) {
-        Bitmap.CompressFormat format = Bitmap.CompressFormat.JPEG;
-        if (nativeImagePath.toLowerCase().endsWith(".png")) {
-            format = Bitmap.CompressFormat.PNG;
-        }
-        Log.e("tag", nativeImagePath);
-        ByteArrayOutputStream baos = new ByteArrayOutputStream();
-        Bitmap bitmap = BitmapFactory.decodeFile(nativeImagePath);
-        bitmap.compress(format, 90, baos);
-        byte[] bytes = baos.toByteArray();
-        bitmap.recycle();
-        Bitmap result = BitmapFactory.decodeByteArray(bytes, 0, bytes.length, null);
+    /**
+     * decodes into {@code options.inBitmap} if it can take the image, otherwise into a new bitmap.
+     */
+    static Bitmap decodeStream(ImageSource source, BitmapFactory.Options options) throws IOException {
+        InputStream inputStream = source.openStream();
         try {
-            baos.close();
-        } catch (IOException e) {
-            e.printStackTrace();
+            return BitmapFactory.decodeStream(inputStream, null, options);
+        } catch (IllegalArgumentException e) {
+            if (options.inBitmap == null) {
+                throw e;
+            }
+            BitmapPool.put(options.inBitmap);
+            options.inBitmap = null;
+        } finally {
+            inputStream.close();
         }
-
-        return result;
+        return decodeStream(source, options);
     }
 
-    public static Bitmap createScaledBitmapWithRatio(Bitmap bitmap, float thumbWidth, boolean recycle) {
-        Bitmap thumb;
-        int imagw = bitmap.getWidth();
-        int imagh = bitmap.getHeight();
+    @TargetApi(Build.VERSION_CODES.P)
+    private static Bitmap decodeWithImageDecoder(ImageSource source, final int maxPixelSize) throws IOException {
+        Bitmap bitmap = ImageDecoder.decodeBitmap(source.createDecoderSource(), new ImageDecoder.OnHeaderDecodedListener() {
+            @Override
+            public void onHeaderDecoded(ImageDecoder decoder, ImageDecoder.ImageInfo info, ImageDecoder.Source src) {
+                Size size = info.getSize();
+                if (MIME_JPEG.equals(info.getMimeType())) {
+                    // scaled in the IDCT, without the extra resample setTargetSize would add on top.
+                    decoder.setTargetSampleSize(computeInSampleSize(size.getWidth(), size.getHeight(), maxPixelSize));
+                } else {
+                    double factor = (double) maxPixelSize / Math.max(size.getWidth(), size.getHeight());
+                    if (factor < 1) {
+                        decoder.setTargetSize(Math.max(1, (int) (size.getWidth() * factor)), Math.max(1, (int) (size.getHeight() * factor)));
+                    }
+                }
+                // the result is scaled and compressed, a hardware bitmap can't be; mutable so it can be pooled.
+                decoder.setAllocator(ImageDecoder.ALLOCATOR_SOFTWARE);
+                decoder.setMutableRequired(true);
+                // RGB_565 for opaque images, whose thumbnail is a JPEG.
+                decoder.setMemorySizePolicy(ImageDecoder.MEMORY_POLICY_LOW_RAM);
+            }
+        });
+        BitmapPool.allocated(bitmap);
+        return bitmap;
+    }
 
-        if (imagh > imagw) {
-            int height = (int) (imagh * thumbWidth / imagw);
-            thumb = Bitmap.createScaledBitmap(bitmap, (int) thumbWidth, height, true);
-        } else {
-            int width = (int) (imagw * thumbWidth / imagh);
-            thumb = Bitmap.createScaledBitmap(bitmap, width, (int) thumbWidth, true);
+    /**
+     * scales {@code bitmap} to fit {@code maxPixelSize} and applies the EXIF {@code orientation}, into a bitmap
+     * from {@link BitmapPool}. The decoder leaves up to about 3x to scale, which the area filter of
+     * {@link ThumbnailCore} does without aliasing; the orientation is then an exact remap of the pixels.
+     *
+     * @param recycle return {@code bitmap} to the pool.
+     */
+    public static Bitmap transform(Bitmap bitmap, int maxPixelSize, int orientation, boolean recycle) {
+        double factor = Math.min(1, (double) maxPixelSize / Math.max(bitmap.getWidth(), bitmap.getHeight()));
+        if (factor >= 1 && orientation == ImageHeader.ORIENTATION_NORMAL) {
+            return bitmap;
         }
 
-        if (recycle) {
-            bitmap.recycle();
+        Bitmap scaled = bitmap;
+        if (factor < 1) {
+            scaled = scale(bitmap, Math.max(1, (int) Math.round(bitmap.getWidth() * factor)),
+                    Math.max(1, (int) Math.round(bitmap.getHeight() * factor)), ThumbnailCore.FILTER_AREA);
+            if (recycle) {
+                BitmapPool.put(bitmap);
+            }
+        }
+        if (orientation == ImageHeader.ORIENTATION_NORMAL) {
+            return scaled;
         }
 
+        Matrix matrix = orientationMatrix(orientation, scaled.getWidth(), scaled.getHeight());
+        boolean swap = swapsDimensions(orientation);
+        Bitmap.Config config = scaled.getConfig() == Bitmap.Config.RGB_565 ? Bitmap.Config.RGB_565 : Bitmap.Config.ARGB_8888;
+        Bitmap thumb = BitmapPool.get(swap ? scaled.getHeight() : scaled.getWidth(),
+                swap ? scaled.getWidth() : scaled.getHeight(), config);
+        // whole quarter turns and flips land on pixel centers, so no filtering is needed.
+        new Canvas(thumb).drawBitmap(scaled, matrix, null);
+        // the encoder is picked by alpha.
+        thumb.setHasAlpha(scaled.hasAlpha());
+        if (scaled != bitmap || recycle) {
+            BitmapPool.put(scaled);
+        }
         return thumb;
     }
 
-    public static Bitmap createScaledBitmap(Bitmap bitmap, int size, boolean recycle) {
-        Bitmap thumb;
-        thumb = Bitmap.createScaledBitmap(bitmap, size, size, true);
-
-        if (recycle) {
-            bitmap.recycle();
+    /**
+     * maps a {@code width x height} image onto the same image with the EXIF {@code orientation} applied,
+     * whose top left corner is at the origin.
+     */
+    static Matrix orientationMatrix(int orientation, int width, int height) {
+        Matrix matrix = new Matrix();
+        switch (orientation) {
+            case 2:
+                matrix.setScale(-1, 1);
+                break;
+            case 3:
+                matrix.setRotate(180);
+                break;
+            case 4:
+                matrix.setRotate(180);
+                matrix.postScale(-1, 1);
+                break;
+            case 5:
+                matrix.setRotate(90);
+                matrix.postScale(-1, 1);
+                break;
+            case 6:
+                matrix.setRotate(90);
+                break;
+            case 7:
+                matrix.setRotate(-90);
+                matrix.postScale(-1, 1);
+                break;
+            case 8:
+                matrix.setRotate(-90);
+                break;
+            default:
+                break;
         }
 
-        return thumb;
+        RectF bounds = new RectF(0, 0, width, height);
+        matrix.mapRect(bounds);
+        matrix.postTranslate(-bounds.left, -bounds.top);
+        return matrix;
     }
 
+    /**
+     * @return true if the EXIF {@code orientation} turns the image a quarter, swapping width and height.
+     */
+    static boolean swapsDimensions(int orientation) {
+        return orientation >= 5 && orientation <= 8;
+    }
 
-    public static Bitmap createScaledBitmapWithRatio(Bitmap bitmap, int maxLength, boolean recycle) {
-
-        Bitmap result = bitmap;
-        while (true) {
-            double ratio = ((double) maxLength) / result.getByteCount();
-            double width = result.getWidth() * Math.sqrt(ratio);
-            double height = result.getHeight() * Math.sqrt(ratio);
-            Bitmap tmp = Bitmap.createScaledBitmap(result, (int) width, (int) height, true);
-            if (result != bitmap) {
-                result.recycle();
-            }
-            result = tmp;
-
-            if (result.getByteCount() < maxLength) {
-                break;
-            }
-
+    /**
+     * {@code source} resampled to {@code width x height} into a bitmap from {@link BitmapPool}, by {@code filter}
+     * of {@link ThumbnailCore}; only a config the core can't read falls back to the Canvas's bilinear one.
+     */
+    static Bitmap scale(Bitmap source, int width, int height, int filter) {
+        Bitmap.Config config = source.getConfig() == Bitmap.Config.RGB_565 ? Bitmap.Config.RGB_565 : Bitmap.Config.ARGB_8888;
+        Bitmap scaled = BitmapPool.get(width, height, config);
+        if (!ThumbnailCore.resample(source, scaled, filter)) {
+            new Canvas(scaled).drawBitmap(source, null, new Rect(0, 0, width, height), new Paint(Paint.FILTER_BITMAP_FLAG));
         }
+        scaled.setHasAlpha(source.hasAlpha());
+        return scaled;
+    }
 
-        if (recycle) {
-            bitmap.recycle();
+    public static Bitmap compress(String nativeImagePath) {
+        Bitmap.CompressFormat format = Bitmap.CompressFormat.JPEG;
+        if (nativeImagePath.toLowerCase().endsWith(".png")) {
+            format = Bitmap.CompressFormat.PNG;
+        }
+        Log.e("tag", nativeImagePath);
+        ByteArrayOutputStream baos = new ByteArrayOutputStream();
+        Bitmap bitmap = BitmapFactory.decodeFile(nativeImagePath);
+        bitmap.compress(format, 90, baos);
+        byte[] bytes = baos.toByteArray();
+        bitmap.recycle();
+        Bitmap result = BitmapFactory.decodeByteArray(bytes, 0, bytes.length, null);
+        try {
+            baos.close();
+        } catch (IOException e) {
+            e.printStackTrace();
         }
 
         return result;
-
     }
 
 }
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2018 The OpenFlutter Organization
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.jarvan.fluwx.utils;
+
+import android.graphics.Bitmap;
+
+/**
+ * The thumbnail core shared with iOS (src/main/cpp/include/fluwx_thumbnail.h): it decides the size and
+ * quality of every thumbnail encode and does the resampling, the platform decodes and encodes.
+ */
+final class ThumbnailCore {
+
+    static {
+        System.loadLibrary("fluwx");
+    }
+
+    static final int FORMAT_JPEG = 0;
+    static final int FORMAT_PNG = 1;
+
+    /**
+     * averages the pixels each output pixel covers: cheap and alias-free at any ratio.
+     */
+    static final int FILTER_AREA = 0;
+
+    /**
+     * Lanczos3 widened by the ratio: sharper than {@link #FILTER_AREA} for about twice the work.
+     */
+    static final int FILTER_LANCZOS3 = 1;
+
+    /**
+     * layout of the {@code int[]} a step of the solver travels in: encode the source resampled to
+     * width x height at quality. Index is 1 for the probe, 2 for the prediction, 3 for the forced downscale.
+     */
+    static final int STEP_WIDTH = 0;
+    static final int STEP_HEIGHT = 1;
+    static final int STEP_QUALITY = 2;
+    static final int STEP_INDEX = 3;
+    static final int STEP_SIZE = 4;
+
+    private ThumbnailCore() {
+    }
+
+    static int formatOf(boolean png) {
+        return png ? FORMAT_PNG : FORMAT_JPEG;
+    }
+
+    /**
+     * most pixels worth encoding for a {@code maxBytes} thumbnail of {@code format}.
+     */
+    static native long pixelCap(long maxBytes, int format);
+
+    /**
+     * longest edge worth decoding for a {@code maxBytes} thumbnail.
+     */
+    static native int maxPixelSize(long maxBytes);
+
+    /**
+     * fills {@code step} with the probe encode.
+     */
+    static native void firstStep(int sourceWidth, int sourceHeight, long maxBytes, int format, int[] step);
+
+    /**
+     * @return true with {@code step} updated if the encode of {@code step}, {@code encodedLength} bytes long,
+     * needs another one; false if it is the result.
+     */
+    static native boolean nextStep(int sourceWidth, int sourceHeight, long maxBytes, int format, int[] step, long encodedLength);
+
+    /**
+     * resamples {@code source} into {@code destination} with {@code filter}, vectorized with NEON or SSE2.
+     *
+     * @return false if the bitmaps aren't both ARGB_8888 or both RGB_565, nothing is drawn then.
+     */
+    static native boolean resample(Bitmap source, Bitmap destination, int filter);
+}
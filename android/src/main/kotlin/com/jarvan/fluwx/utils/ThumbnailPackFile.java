@@ -0,0 +1,336 @@
+/*
+ * Copyright (C) 2018 The OpenFlutter Organization
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.jarvan.fluwx.utils;
+
+import android.util.Log;
+
+import java.io.File;
+import java.io.IOException;
+import java.io.RandomAccessFile;
+import java.nio.ByteBuffer;
+import java.nio.MappedByteBuffer;
+import java.nio.channels.FileChannel;
+import java.nio.charset.Charset;
+import java.util.AbstractMap;
+import java.util.ArrayList;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+
+/**
+ * Append-only store for small encoded thumbnails in a single memory-mapped file.
+ * <p>
+ * A record is {@code magic, key, validator, expiresAt, data}; a newer record for the same key
+ * supersedes older ones. The index is rebuilt on open by walking the record headers in the mapping,
+ * so a cold start costs one open and one mmap instead of one open per thumbnail. Once the file is
+ * over its budget, least recently used records are dropped by rewriting the live ones into a new
+ * pack on a background thread.
+ */
+class ThumbnailPackFile {
+
+    private static final String TAG = "fluwx";
+    private static final int MAGIC = 0x46545042; // FTPB
+    private static final Charset UTF_8 = Charset.forName("UTF-8");
+    private static final ExecutorService COMPACTOR = Executors.newSingleThreadExecutor();
+
+    /**
+     * larger entries aren't stored; thumbnails are at most 120 KB.
+     */
+    static final int MAX_ENTRY_SIZE = 128 * 1024;
+
+    static class Record {
+        final long dataOffset;
+        final int dataLength;
+        final String validator;
+        final long expiresAt;
+
+        Record(long dataOffset, int dataLength, String validator, long expiresAt) {
+            this.dataOffset = dataOffset;
+            this.dataLength = dataLength;
+            this.validator = validator;
+            this.expiresAt = expiresAt;
+        }
+    }
+
+    private final File file;
+    private final long maxSize;
+
+    // access ordered, least recently used first.
+    private final LinkedHashMap<String, Record> index = new LinkedHashMap<>(64, 0.75f, true);
+    private RandomAccessFile randomAccessFile;
+    private FileChannel channel;
+    private MappedByteBuffer mapped;
+    private long end;
+    private boolean compacting;
+
+    ThumbnailPackFile(File file, long maxSize) {
+        this.file = file;
+        this.maxSize = maxSize;
+    }
+
+    /**
+     * @return a read-only slice of the mapping, or null if {@code key} isn't stored.
+     */
+    synchronized ByteBuffer get(String key, Record[] recordOut) {
+        if (!open()) {
+            return null;
+        }
+        Record record = index.get(key);
+        if (record == null) {
+            return null;
+        }
+        if (record.dataOffset + record.dataLength > mapped.capacity() && !remap()) {
+            return null;
+        }
+        if (recordOut != null) {
+            recordOut[0] = record;
+        }
+        ByteBuffer slice = mapped.duplicate();
+        slice.position((int) record.dataOffset);
+        slice.limit((int) (record.dataOffset + record.dataLength));
+        return slice.slice().asReadOnlyBuffer();
+    }
+
+    synchronized void put(String key, String validator, long expiresAt, byte[] data) {
+        if (data.length > MAX_ENTRY_SIZE || !open()) {
+            return;
+        }
+        byte[] keyBytes = key.getBytes(UTF_8);
+        byte[] validatorBytes = validator == null ? null : validator.getBytes(UTF_8);
+        int headerLength = 4 + 4 + keyBytes.length + 4 + (validatorBytes == null ? 0 : validatorBytes.length) + 8 + 4;
+        ByteBuffer header = ByteBuffer.allocate(headerLength);
+        header.putInt(MAGIC);
+        header.putInt(keyBytes.length).put(keyBytes);
+        if (validatorBytes == null) {
+            header.putInt(-1);
+        } else {
+            header.putInt(validatorBytes.length).put(validatorBytes);
+        }
+        header.putLong(expiresAt);
+        header.putInt(data.length);
+        header.flip();
+        // the data is written from the caller's array rather than copied behind the header.
+        ByteBuffer[] record = {header, ByteBuffer.wrap(data)};
+
+        try {
+            long recordOffset = end;
+            channel.position(recordOffset);
+            while (record[1].hasRemaining()) {
+                channel.write(record);
+            }
+            end = recordOffset + headerLength + data.length;
+            index.put(key, new Record(recordOffset + headerLength, data.length, validator, expiresAt));
+        } catch (IOException e) {
+            Log.i(TAG, "writing thumbnail pack failed:\n" + e.getMessage());
+            return;
+        }
+
+        if (end > maxSize && !compacting) {
+            compacting = true;
+            COMPACTOR.execute(new Runnable() {
+                @Override
+                public void run() {
+                    compact();
+                }
+            });
+        }
+    }
+
+    private boolean open() {
+        if (channel != null) {
+            return true;
+        }
+        try {
+            File directory = file.getParentFile();
+            if (directory != null && !directory.isDirectory() && !directory.mkdirs()) {
+                return false;
+            }
+            randomAccessFile = new RandomAccessFile(file, "rw");
+            channel = randomAccessFile.getChannel();
+            if (!remap()) {
+                return false;
+            }
+            scan();
+            return true;
+        } catch (IOException e) {
+            Log.i(TAG, "opening thumbnail pack failed:\n" + e.getMessage());
+            close();
+            return false;
+        }
+    }
+
+    private boolean remap() {
+        try {
+            mapped = channel.map(FileChannel.MapMode.READ_ONLY, 0, channel.size());
+            return true;
+        } catch (IOException e) {
+            Log.i(TAG, "mapping thumbnail pack failed:\n" + e.getMessage());
+            return false;
+        }
+    }
+
+    /**
+     * rebuilds the index from the record headers; a torn record at the end is cut off.
+     */
+    private void scan() throws IOException {
+        index.clear();
+        ByteBuffer buffer = mapped.duplicate();
+        long position = 0;
+        try {
+            while (buffer.remaining() >= 4 && buffer.getInt() == MAGIC) {
+                String key = readString(buffer);
+                String validator = readString(buffer);
+                long expiresAt = buffer.getLong();
+                int dataLength = buffer.getInt();
+                if (key == null || dataLength < 0 || dataLength > buffer.remaining()) {
+                    break;
+                }
+                index.put(key, new Record(buffer.position(), dataLength, validator, expiresAt));
+                buffer.position(buffer.position() + dataLength);
+                position = buffer.position();
+            }
+        } catch (RuntimeException e) {
+            // BufferUnderflowException or a corrupt length: keep the records before it.
+        }
+        end = position;
+        if (end < channel.size()) {
+            channel.truncate(end);
+            remap();
+        }
+    }
+
+    private static String readString(ByteBuffer buffer) {
+        int length = buffer.getInt();
+        if (length == -1) {
+            return null;
+        }
+        if (length < 0 || length > buffer.remaining()) {
+            throw new IllegalStateException("corrupt record");
+        }
+        byte[] bytes = new byte[length];
+        buffer.get(bytes);
+        return new String(bytes, UTF_8);
+    }
+
+    /**
+     * rewrites the most recently used records, up to three quarters of the budget, into a new pack.
+     * The records are copied from a snapshot of the mapping without holding the lock, so lookups and
+     * stores carry on meanwhile; the lock is only taken again to copy what was stored since and swap the
+     * files. If that fails the pack is emptied instead, it only holds what can be encoded again.
+     */
+    private void compact() {
+        File compacted = new File(file.getPath() + ".tmp");
+        ThumbnailPackFile target = new ThumbnailPackFile(compacted, Long.MAX_VALUE);
+        List<Map.Entry<String, Record>> keep;
+        ByteBuffer snapshot;
+        long snapshotEnd;
+        synchronized (this) {
+            // records put since the last mapping lie past its end.
+            if (!open() || !remap()) {
+                compactionFailed(target, compacted, new IOException("pack can't be mapped"));
+                return;
+            }
+            List<Map.Entry<String, Record>> records = new ArrayList<>(index.size());
+            // the index's own entries would follow a key put again meanwhile.
+            for (Map.Entry<String, Record> entry : index.entrySet()) {
+                records.add(new AbstractMap.SimpleImmutableEntry<>(entry.getKey(), entry.getValue()));
+            }
+            long kept = 0;
+            int first = records.size();
+            while (first > 0 && kept + records.get(first - 1).getValue().dataLength <= maxSize * 3 / 4) {
+                first--;
+                kept += records.get(first).getValue().dataLength;
+            }
+            keep = new ArrayList<>(records.subList(first, records.size()));
+            // records are never rewritten in place, so this stays valid whatever is appended meanwhile.
+            snapshot = mapped.duplicate();
+            snapshotEnd = end;
+        }
+
+        try {
+            compacted.delete();
+            for (Map.Entry<String, Record> entry : keep) {
+                copy(snapshot, entry.getKey(), entry.getValue(), target);
+            }
+        } catch (RuntimeException e) {
+            synchronized (this) {
+                compactionFailed(target, compacted, e);
+            }
+            return;
+        }
+
+        synchronized (this) {
+            try {
+                if (!remap()) {
+                    throw new IOException("pack can't be mapped");
+                }
+                for (Map.Entry<String, Record> entry : index.entrySet()) {
+                    if (entry.getValue().dataOffset >= snapshotEnd) {
+                        copy(mapped, entry.getKey(), entry.getValue(), target);
+                    }
+                }
+                target.close();
+
+                close();
+                if (!compacted.renameTo(file)) {
+                    compacted.delete();
+                    file.delete();
+                }
+                open();
+                compacting = false;
+            } catch (IOException | RuntimeException e) {
+                compactionFailed(target, compacted, e);
+            }
+        }
+    }
+
+    private static void copy(ByteBuffer source, String key, Record record, ThumbnailPackFile target) {
+        byte[] data = new byte[record.dataLength];
+        ByteBuffer slice = source.duplicate();
+        slice.position((int) record.dataOffset);
+        slice.get(data);
+        target.put(key, record.validator, record.expiresAt, data);
+    }
+
+    /**
+     * empties the pack; called with the lock held.
+     */
+    private void compactionFailed(ThumbnailPackFile target, File compacted, Exception e) {
+        Log.i(TAG, "compacting thumbnail pack failed, emptying it:\n" + e.getMessage());
+        target.close();
+        compacted.delete();
+        close();
+        file.delete();
+        open();
+        compacting = false;
+    }
+
+    private void close() {
+        index.clear();
+        mapped = null;
+        try {
+            if (randomAccessFile != null) {
+                randomAccessFile.close();
+            }
+        } catch (IOException ignored) {
+        }
+        randomAccessFile = null;
+        channel = null;
+        end = 0;
+    }
+}
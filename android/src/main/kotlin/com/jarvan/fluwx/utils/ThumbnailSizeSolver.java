@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2018 The OpenFlutter Organization
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.jarvan.fluwx.utils;
+
+import android.graphics.Bitmap;
+
+/**
+ * Fits a bitmap into a thumbnail byte budget.
+ * <p>
+ * The steps come from {@link ThumbnailCore}, shared with iOS: it caps the pixel count from the
+ * budget, has one probe encoded and then predicts the quality and dimensions that land under the
+ * budget, so a thumbnail costs at most two encodes. Only if the prediction overshoots is there a
+ * third, forced downscale to a size at which even uncompressed pixels fit the budget; if that misses
+ * too there is no result. Encodes are counted in {@link MediaStats}.
+ */
+public class ThumbnailSizeSolver {
+
+    private ThumbnailSizeSolver() {
+    }
+
+    public static class Result {
+        /**
+         * null if even the forced downscale came out over the budget: WeChat rejects such an image silently.
+         */
+        public final byte[] data;
+        public final int width;
+        public final int height;
+        public final int quality;
+        public final int encodeCount;
+
+        Result(byte[] data, int width, int height, int quality, int encodeCount) {
+            this.data = data;
+            this.width = width;
+            this.height = height;
+            this.quality = quality;
+            this.encodeCount = encodeCount;
+        }
+    }
+
+    /**
+     * @param source   bitmap to fit, it is not recycled.
+     * @param maxBytes byte budget, e.g. {@link ThumbnailSpec#COMMON_THUMB_LENGTH}.
+     */
+    public static Result solve(Bitmap source, int maxBytes) {
+        return solve(source, maxBytes, source.hasAlpha() ? Bitmap.CompressFormat.PNG : Bitmap.CompressFormat.JPEG);
+    }
+
+    /**
+     * @param format PNG or JPEG, whatever alpha {@code source} has.
+     */
+    public static Result solve(Bitmap source, int maxBytes, Bitmap.CompressFormat format) {
+        int coreFormat = ThumbnailCore.formatOf(format == Bitmap.CompressFormat.PNG);
+        int width = source.getWidth();
+        int height = source.getHeight();
+
+        int[] step = new int[ThumbnailCore.STEP_SIZE];
+        ThumbnailCore.firstStep(width, height, maxBytes, coreFormat, step);
+        Bitmap working = source;
+        // encodes are measured in their pooled buffers; only the one that fits is copied out.
+        PooledByteArrayOutputStream data = null;
+        int encodeCount = 0;
+        do {
+            working = resample(source, working, step[ThumbnailCore.STEP_WIDTH], step[ThumbnailCore.STEP_HEIGHT]);
+            if (data != null) {
+                data.close();
+            }
+            data = encode(working, format, step[ThumbnailCore.STEP_QUALITY], maxBytes);
+            encodeCount++;
+        } while (ThumbnailCore.nextStep(width, height, maxBytes, coreFormat, step, data.size()));
+
+        if (step[ThumbnailCore.STEP_INDEX] == 3) {
+            MediaStats.SOLVER_FORCED_DOWNSCALES.incrementAndGet();
+        }
+        MediaStats.SOLVER_RUNS.incrementAndGet();
+        MediaStats.SOLVER_ENCODES.addAndGet(encodeCount);
+        boolean fits = data.size() <= maxBytes;
+        if (!fits) {
+            MediaStats.SOLVER_MISSES.incrementAndGet();
+        }
+
+        Result result = new Result(fits ? data.toByteArray() : null, working.getWidth(), working.getHeight(),
+                step[ThumbnailCore.STEP_QUALITY], encodeCount);
+        data.close();
+        if (working != source) {
+            BitmapPool.put(working);
+        }
+        return result;
+    }
+
+    /**
+     * {@code source} resampled to {@code width x height}, in a single pass and never from a previous candidate.
+     * {@code previous} is kept if it already has that size and returned to the pool otherwise.
+     */
+    private static Bitmap resample(Bitmap source, Bitmap previous, int width, int height) {
+        if (previous.getWidth() == width && previous.getHeight() == height) {
+            return previous;
+        }
+        if (previous != source) {
+            BitmapPool.put(previous);
+        }
+        if (source.getWidth() == width && source.getHeight() == height) {
+            return source;
+        }
+        return ThumbnailCompressUtil.scale(source, width, height, ThumbnailCore.FILTER_LANCZOS3);
+    }
+
+    private static PooledByteArrayOutputStream encode(Bitmap bitmap, Bitmap.CompressFormat format, int quality, int expectedSize) {
+        // no larger than the pixels: a transcode's budget of several MB needn't be allocated for a small bitmap.
+        PooledByteArrayOutputStream output = new PooledByteArrayOutputStream((int) Math.min(expectedSize, (long) bitmap.getByteCount()));
+        bitmap.compress(format, quality, output);
+        return output;
+    }
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2018 The OpenFlutter Organization
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.jarvan.fluwx.utils;
+
+/**
+ * Parameters of the thumbnail pipeline (decode -> resample -> size-budgeted encode).
+ * iOS reads the same values from ThumbnailSpec.m; change both together. The solver's own
+ * parameters live in the shared core, src/main/cpp/thumbnail_solver.cpp.
+ */
+public final class ThumbnailSpec {
+
+    public static final int COMMON_THUMB_LENGTH = 32 * 1024;
+    public static final int MINI_PROGRAM_THUMB_LENGTH = 120 * 1024;
+
+    /**
+     * a JPEG or PNG within the byte budget and at most this long on its longest edge is sent as is.
+     */
+    public static final int PASSTHROUGH_MAX_EDGE = 1024;
+
+    /**
+     * an embedded EXIF thumbnail is used as is only if its longest edge is at least this long...
+     */
+    public static final int EMBEDDED_THUMB_MIN_EDGE = 120;
+
+    /**
+     * ...and its aspect ratio is within this relative difference of the image's, which rejects letterboxed ones.
+     */
+    public static final double EMBEDDED_THUMB_ASPECT_TOLERANCE = 0.02;
+
+    /**
+     * a downloaded shared image may be this long; it is transcoded into WeChat's limit afterwards.
+     * A longer one is abandoned, see {@link MediaTooLargeException}.
+     */
+    public static final long MAX_IMAGE_FETCH_BYTES = 4L * ShareImageUtil.WX_MAX_IMAGE_BYTE_SIZE;
+
+    /**
+     * a downloaded thumbnail source may be this long.
+     */
+    public static final long MAX_THUMBNAIL_FETCH_BYTES = 10 * 1024 * 1024;
+
+    private ThumbnailSpec() {
+    }
+
+    /**
+     * longest edge worth decoding for a {@code maxBytes} thumbnail: the pixel cap of the solver
+     * for images up to 2:1, so it never has to upscale.
+     */
+    public static int maxPixelSize(int maxBytes) {
+        return ThumbnailCore.maxPixelSize(maxBytes);
+    }
+}
@@ -15,302 +15,209 @@
  */
 package com.jarvan.fluwx.utils;
 
-import android.content.Context;
-import android.content.res.AssetFileDescriptor;
 import android.graphics.Bitmap;
 import android.graphics.BitmapFactory;
-import android.net.Uri;
-import android.text.TextUtils;
 import android.util.Log;
 
-import com.jarvan.fluwx.constant.WeChatPluginImageSchema;
-import com.jarvan.fluwx.constant.WechatPluginKeys;
-
 import java.io.ByteArrayInputStream;
-import java.io.ByteArrayOutputStream;
-import java.io.File;
-import java.io.FileOutputStream;
 import java.io.IOException;
 import java.io.InputStream;
-import java.io.OutputStream;
-import java.util.UUID;
 
 import io.flutter.plugin.common.PluginRegistry;
-import okhttp3.OkHttpClient;
-import okhttp3.Request;
-import okhttp3.Response;
-import okhttp3.ResponseBody;
-import okio.BufferedSink;
-import okio.BufferedSource;
-import okio.Okio;
-import okio.Source;
-import top.zibin.luban.Luban;
 
 public class WeChatThumbnailUtil {
-    public static final int SHARE_MINI_PROGRAM_IMAGE_THUMB_LENGTH = 120 * 1024;
-    public static final int SHARE_IMAGE_THUMB_LENGTH = 32 * 1024;
-    private static final int COMMON_THUMB_WIDTH = 150;
+    public static final int SHARE_MINI_PROGRAM_IMAGE_THUMB_LENGTH = ThumbnailSpec.MINI_PROGRAM_THUMB_LENGTH;
+    public static final int SHARE_IMAGE_THUMB_LENGTH = ThumbnailSpec.COMMON_THUMB_LENGTH;
+    private static final String TAG = "fluwx";
+    private static final String CONTENT_KEY_PREFIX = "sha256:";
 
     private WeChatThumbnailUtil() {
     }
 
     public static byte[] thumbnailForMiniProgram(String thumbnail, PluginRegistry.Registrar registrar) {
-        File file;
-        if (thumbnail.startsWith(WeChatPluginImageSchema.SCHEMA_ASSETS)) {
-            file = getAssetFile(thumbnail, registrar);
-        } else if (thumbnail.startsWith(WeChatPluginImageSchema.SCHEMA_FILE)) {
-            String pathWithoutUri = thumbnail.substring(WeChatPluginImageSchema.SCHEMA_FILE.length());
-            file = new File(pathWithoutUri);
-        } else if (thumbnail.startsWith(WeChatPluginImageSchema.SCHEMA_CONTENT)) {
-            file = getFileFromContentProvider(registrar, thumbnail);
-        } else {
-            file = downloadImage(thumbnail);
-        }
-        return compress(file, registrar, SHARE_MINI_PROGRAM_IMAGE_THUMB_LENGTH);
+        return compress(registrar, ImageSource.from(registrar, thumbnail, ThumbnailSpec.MAX_THUMBNAIL_FETCH_BYTES), SHARE_MINI_PROGRAM_IMAGE_THUMB_LENGTH, false);
     }
 
+    public static byte[] thumbnailForCommon(String thumbnail, PluginRegistry.Registrar registrar) {
+        return compress(registrar, ImageSource.from(registrar, thumbnail, ThumbnailSpec.MAX_THUMBNAIL_FETCH_BYTES), SHARE_IMAGE_THUMB_LENGTH, false);
+    }
 
-    private static byte[] fromAssetForMiniProgram(String thumbnail, PluginRegistry.Registrar registrar) {
-        File file;
-        if (thumbnail.startsWith(WeChatPluginImageSchema.SCHEMA_ASSETS)) {
-            file = getAssetFile(thumbnail, registrar);
-        } else if (thumbnail.startsWith(WeChatPluginImageSchema.SCHEMA_FILE)) {
-            file = new File(thumbnail);
-        } else {
-            file = downloadImage(thumbnail);
-        }
-        return compress(file, registrar, SHARE_MINI_PROGRAM_IMAGE_THUMB_LENGTH);
+    /**
+     * thumbnail of a shared image when the caller didn't give one: the image itself if it is small enough,
+     * the JPEG's embedded EXIF thumbnail if it is usable, otherwise the image is decoded and compressed
+     * like any other thumbnail.
+     */
+    public static byte[] thumbnailForImage(String image, PluginRegistry.Registrar registrar) {
+        return thumbnailForImage(ImageSource.from(registrar, image, ThumbnailSpec.MAX_IMAGE_FETCH_BYTES), registrar);
     }
 
-    public static byte[] thumbnailForCommon(String thumbnail, PluginRegistry.Registrar registrar) {
-        File file;
-        if (thumbnail.startsWith(WeChatPluginImageSchema.SCHEMA_ASSETS)) {
-            file = getAssetFile(thumbnail, registrar);
-        } else if (thumbnail.startsWith(WeChatPluginImageSchema.SCHEMA_FILE)) {
-            String pathWithoutUri = thumbnail.substring(WeChatPluginImageSchema.SCHEMA_FILE.length());
-            file = new File(pathWithoutUri);
-        } else if (thumbnail.startsWith(WeChatPluginImageSchema.SCHEMA_CONTENT)) {
-            file = getFileFromContentProvider(registrar, thumbnail);
-        } else {
-            file = downloadImage(thumbnail);
-        }
-        return compress(file, registrar, SHARE_IMAGE_THUMB_LENGTH);
+    /**
+     * @param source the source the shared image was read from, so a network image isn't downloaded twice.
+     */
+    public static byte[] thumbnailForImage(ImageSource source, PluginRegistry.Registrar registrar) {
+        return compress(registrar, source, SHARE_IMAGE_THUMB_LENGTH, true);
     }
 
-    private static byte[] compress(File file, PluginRegistry.Registrar registrar, int resultMaxLength) {
-        if (file == null) {
-            return new byte[]{};
+    /**
+     * @return true if {@code original} is a JPEG or PNG that WeChat takes as a thumbnail as is,
+     * so it needs neither decode nor encode.
+     */
+    private static boolean canPassThrough(byte[] original, int resultMaxLength) {
+        if (original.length > resultMaxLength) {
+            return false;
         }
-
-
+        ImageHeader header;
         try {
-            File compressedFile = Luban
-                    .with(registrar.context())
-                    .ignoreBy(resultMaxLength)
-                    .setTargetDir(registrar.context().getCacheDir().getAbsolutePath())
-                    .get(file.getAbsolutePath());
-            if (compressedFile.length() < resultMaxLength) {
-                Source source = Okio.source(compressedFile);
-                BufferedSource bufferedSource = Okio.buffer(source);
-                byte[] bytes = bufferedSource.readByteArray();
-                source.close();
-                bufferedSource.close();
-                return bytes;
-            }
-            return createScaledBitmapWithRatio(compressedFile, resultMaxLength);
-
-
+            header = ImageHeader.parse(new ByteArrayInputStream(original));
         } catch (IOException e) {
-            e.printStackTrace();
+            return false;
         }
-        return new byte[]{};
+        return (header.format == ImageHeader.FORMAT_JPEG || header.format == ImageHeader.FORMAT_PNG)
+                && header.hasSize()
+                && Math.max(header.width, header.height) <= ThumbnailSpec.PASSTHROUGH_MAX_EDGE
+                && header.orientation == ImageHeader.ORIENTATION_NORMAL;
     }
 
-    private static byte[] createScaledBitmapWithRatio(File file, int resultMaxLength) {
-
-        Bitmap originBitmap = BitmapFactory.decodeFile(file.getAbsolutePath());
-        Bitmap result = ThumbnailCompressUtil.createScaledBitmapWithRatio(originBitmap, resultMaxLength, true);
-
-        String path = file.getAbsolutePath();
-        String suffix = path.substring(path.lastIndexOf("."), path.length());
-        return bmpToByteArray(result, suffix, true);
-
-
-    }
-
-    private static byte[] createScaledBitmap(File file, int resultMaxLength, int scaledWidth) {
-        Bitmap originBitmap = BitmapFactory.decodeFile(file.getAbsolutePath());
-
-        Bitmap result = null;
-
-        int width = scaledWidth;
-        while (width > 10) {
-            result = ThumbnailCompressUtil.createScaledBitmap(originBitmap, width, false);
-            if (result.getByteCount() < resultMaxLength * 1024) {
-                break;
-            } else {
-                width = width - 10;
+    /**
+     * @return null if {@code source} has no embedded thumbnail that is large enough, has the
+     * image's aspect ratio and fits {@code resultMaxLength}.
+     */
+    private static byte[] embeddedThumbnail(ImageSource source, int resultMaxLength) {
+        ImageHeader header;
+        ImageHeader thumbnailHeader;
+        try {
+            InputStream inputStream = source.openStream();
+            try {
+                header = ImageHeader.parse(inputStream);
+            } finally {
+                inputStream.close();
+            }
+            if (header.thumbnail == null || !header.hasSize()) {
+                return null;
             }
+            thumbnailHeader = ImageHeader.parse(new ByteArrayInputStream(header.thumbnail));
+        } catch (IOException e) {
+            return null;
         }
 
-        originBitmap.recycle();
-
-        return bmpToByteArray(result, ".png", true);
-    }
-
-    private static byte[] bmpToByteArray(Bitmap bitmap, String suffix, boolean recycle) {
-//        int bytes = bitmap.getByteCount();
-//        ByteBuffer buf = ByteBuffer.allocate(bytes);
-//        bitmap.copyPixelsToBuffer(buf);
-        ByteArrayOutputStream byteArrayOutputStream = new ByteArrayOutputStream();
-        Bitmap.CompressFormat format = Bitmap.CompressFormat.PNG;
-        if (suffix.toLowerCase().equals(".jpg") || suffix.toLowerCase().equals(".jpeg")) {
-            format = Bitmap.CompressFormat.JPEG;
+        if (!thumbnailHeader.hasSize()
+                || Math.max(thumbnailHeader.width, thumbnailHeader.height) < ThumbnailSpec.EMBEDDED_THUMB_MIN_EDGE) {
+            return null;
+        }
+        double aspect = (double) header.width / header.height;
+        double thumbnailAspect = (double) thumbnailHeader.width / thumbnailHeader.height;
+        if (Math.abs(thumbnailAspect / aspect - 1) > ThumbnailSpec.EMBEDDED_THUMB_ASPECT_TOLERANCE) {
+            return null;
         }
 
-        bitmap.compress(format, 100, byteArrayOutputStream);
-        InputStream inputStream = new ByteArrayInputStream(byteArrayOutputStream.toByteArray());
-        byte[] result = null;
-
-        if (recycle) {
-            bitmap.recycle();
+        if (header.orientation == ImageHeader.ORIENTATION_NORMAL && header.thumbnail.length <= resultMaxLength) {
+            return header.thumbnail;
         }
-        Source source = Okio.source(inputStream);
-        BufferedSource bufferedSource = Okio.buffer(source);
+
+        // rotating (or shrinking) the embedded thumbnail is still far cheaper than decoding the image.
+        BitmapFactory.Options options = new BitmapFactory.Options();
+        options.inPreferredConfig = BitmapPool.configFor(true, true);
+        BitmapPool.prepareDecode(options, thumbnailHeader.width, thumbnailHeader.height);
+        Bitmap bitmap;
         try {
-            result = bufferedSource.readByteArray();
-            source.close();
-            bufferedSource.close();
-        } catch (IOException e) {
-            e.printStackTrace();
+            bitmap = BitmapPool.decoded(BitmapFactory.decodeByteArray(header.thumbnail, 0, header.thumbnail.length, options), options);
+        } catch (IllegalArgumentException e) {
+            BitmapPool.decoded(null, options);
+            bitmap = BitmapPool.decoded(BitmapFactory.decodeByteArray(header.thumbnail, 0, header.thumbnail.length, options), options);
+        }
+        if (bitmap == null) {
+            return null;
         }
-        return result;
+        bitmap = ThumbnailCompressUtil.transform(bitmap, Integer.MAX_VALUE, header.orientation, true);
+        return solve(bitmap, resultMaxLength);
     }
 
-    private static File getAssetFile(String thumbnail, PluginRegistry.Registrar registrar) {
-        File result = null;
-        int endIndex = thumbnail.length();
-        int indexOfPackage = thumbnail.indexOf(WechatPluginKeys.PACKAGE);
-        if (indexOfPackage > 0) {
-            endIndex = indexOfPackage;
+    /**
+     * @param useEmbedded whether the EXIF thumbnail of {@code source} may stand in for it.
+     */
+    private static byte[] compress(PluginRegistry.Registrar registrar, ImageSource source, int resultMaxLength, boolean useEmbedded) {
+        if (source == null) {
+            return new byte[]{};
         }
-        String key = thumbnail.substring(WeChatPluginImageSchema.SCHEMA_ASSETS.length(), endIndex);
-//        flutter_assets/packages/flutter_gallery_assets/ali_connors.jpg?package=flutter_gallery_assets
-        AssetFileDescriptor fileDescriptor = AssetManagerUtil.openAsset(registrar, key, getPackage(thumbnail));
 
-        if (fileDescriptor != null) {
-            try {
-                result = File.createTempFile(UUID.randomUUID().toString(), getSuffix(key));
-                OutputStream outputStream = new FileOutputStream(result);
-                BufferedSink sink = Okio.buffer(Okio.sink(outputStream));
-                Source source = Okio.source(fileDescriptor.createInputStream());
-                sink.writeAll(source);
-                source.close();
-                sink.close();
-            } catch (IOException e) {
-                e.printStackTrace();
+        String imageKey = source.cacheKey();
+        if (imageKey == null) {
+            return compress(source, resultMaxLength, useEmbedded);
+        }
+        ThumbnailCache cache = ThumbnailCache.getInstance(registrar.context());
+        String cacheKey = ThumbnailCache.key(imageKey, resultMaxLength, useEmbedded);
+        ThumbnailCache.Entry entry = cache.get(cacheKey);
+        if (entry != null && source.isCurrent(entry.validator, entry.expiresAt)) {
+            // revalidated: keep the new freshness lifetime.
+            if (source.expiresAt() > entry.expiresAt) {
+                cache.put(cacheKey, entry.validator, source.expiresAt(), entry.data);
+            }
+            return entry.data;
+        }
+
+        // the same bytes may have been seen under another URL.
+        String contentHash = source.contentHash();
+        String contentKey = contentHash == null ? null : ThumbnailCache.key(CONTENT_KEY_PREFIX + contentHash, resultMaxLength, useEmbedded);
+        byte[] data = null;
+        if (contentKey != null) {
+            ThumbnailCache.Entry contentEntry = cache.get(contentKey);
+            if (contentEntry != null) {
+                MediaStats.THUMBNAIL_DEDUP_HITS.incrementAndGet();
+                data = contentEntry.data;
+            } else {
+                MediaStats.THUMBNAIL_DEDUP_MISSES.incrementAndGet();
             }
         }
-        return result;
-    }
 
-    private static String getPackage(String assetsName) {
-        String packageStr = null;
-        if (assetsName.contains(WechatPluginKeys.PACKAGE)) {
-            int index = assetsName.indexOf(WechatPluginKeys.PACKAGE);
-            packageStr = assetsName.substring(index + WechatPluginKeys.PACKAGE.length(), assetsName.length());
+        if (data == null) {
+            data = compress(source, resultMaxLength, useEmbedded);
+            if (contentKey != null) {
+                // content never changes under its hash.
+                cache.put(contentKey, contentHash, Long.MAX_VALUE, data);
+            }
+        }
+        if (source.validator() != null || source.expiresAt() > System.currentTimeMillis()) {
+            cache.put(cacheKey, source.validator(), source.expiresAt(), data);
         }
-        return packageStr;
+        return data;
     }
 
-    private static File downloadImage(String url) {
+    private static byte[] compress(ImageSource source, int resultMaxLength, boolean useEmbedded) {
 
-        if(!url.startsWith("https") && !url.startsWith("http")){
-            url = "http://"+url;
+        // small sources are read once; they either pass through or are decoded from memory.
+        long length = source.length();
+        if (length >= 0 && length <= resultMaxLength) {
+            try {
+                byte[] original = source.readBytes();
+                if (canPassThrough(original, resultMaxLength)) {
+                    MediaStats.THUMBNAIL_PASSTHROUGHS.incrementAndGet();
+                    return original;
+                }
+                source = new ImageSource.BytesSource(original);
+            } catch (IOException e) {
+                Log.i(TAG, "reading image failed:\n" + e.getMessage());
+            }
         }
 
-        File result = null;
-        OkHttpClient okHttpClient = new OkHttpClient.Builder().build();
-        Request request = new Request.Builder().url(url).get().build();
-        try {
-            Response response = okHttpClient.newCall(request).execute();
-            ResponseBody responseBody = response.body();
-            if (response.isSuccessful() && responseBody != null) {
-                result = File.createTempFile(UUID.randomUUID().toString(), getSuffix(url));
-                OutputStream outputStream = new FileOutputStream(result);
-                BufferedSink sink = Okio.buffer(Okio.sink(outputStream));
-                sink.writeAll(responseBody.source());
-                sink.flush();
-                sink.close();
+        if (useEmbedded) {
+            byte[] embedded = embeddedThumbnail(source, resultMaxLength);
+            if (embedded != null) {
+                MediaStats.THUMBNAIL_EMBEDDED.incrementAndGet();
+                return embedded;
             }
-
-        } catch (IOException e) {
-            e.printStackTrace();
         }
 
-        return result;
-    }
-
-
-    private static File inputStreamToFile(InputStream inputStream, String suffix) {
-        File result = null;
-        try {
-            result = File.createTempFile(UUID.randomUUID().toString(), suffix);
-            OutputStream outputStream = new FileOutputStream(result);
-            BufferedSink sink = Okio.buffer(Okio.sink(outputStream));
-            Source source = Okio.source(inputStream);
-            sink.writeAll(source);
-            sink.flush();
-            sink.close();
-            source.close();
-        } catch (IOException e) {
-            e.printStackTrace();
+        Bitmap bitmap = ThumbnailCompressUtil.decodeSampledBitmap(source, ThumbnailSpec.maxPixelSize(resultMaxLength));
+        if (bitmap == null) {
+            return new byte[]{};
         }
 
-        return result;
+        return solve(bitmap, resultMaxLength);
     }
 
-    private static String getSuffix(String path) {
-        String suffix = ".jpg";
-        if (path.endsWith(".png")) {
-            suffix = ".png";
-        }
-        return suffix;
-    }
-
-    private static File getFileFromContentProvider(PluginRegistry.Registrar registrar, String path) {
-        Source source = null;
-        BufferedSink sink = null;
-
-        File file = null;
-        try {
-            Context context = registrar.context().getApplicationContext();
-            Uri uri = Uri.parse(path);
-            String suffix = null;
-            String mimeType = context.getContentResolver().getType(uri);
-            if (TextUtils.equals(mimeType, "image/jpeg") || TextUtils.equals(mimeType, "image/jpg")) {
-                suffix = ".jpg";
-            } else if (TextUtils.equals(mimeType, "image/png")) {
-                suffix = ".png";
-            }
-
-
-            file = File.createTempFile(UUID.randomUUID().toString(), suffix);
-            InputStream inputStream = context.getContentResolver().openInputStream(uri);
-
-            if (inputStream == null) {
-                return null;
-            }
-            OutputStream outputStream = new FileOutputStream(file);
-            sink = Okio.buffer(Okio.sink(outputStream));
-            source = Okio.source(inputStream);
-            sink.writeAll(source);
-            source.close();
-            sink.close();
-        } catch (IOException e) {
-            Log.i("fluwx", "reading image failed:\n" + e.getMessage());
-        }
-
-        return file;
+    private static byte[] solve(Bitmap bitmap, int resultMaxLength) {
+        ThumbnailSizeSolver.Result result = ThumbnailSizeSolver.solve(bitmap, resultMaxLength);
+        BitmapPool.put(bitmap);
+        return result.data;
     }
 }
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2018 The OpenFlutter Organization
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.jarvan.fluwx.utils;
+
+import org.junit.After;
+import org.junit.Before;
+import org.junit.Rule;
+import org.junit.Test;
+import org.junit.rules.TemporaryFolder;
+
+import java.io.IOException;
+
+import okhttp3.Request;
+import okhttp3.Response;
+import okhttp3.mockwebserver.MockResponse;
+import okhttp3.mockwebserver.MockWebServer;
+
+import static org.junit.Assert.assertEquals;
+
+/**
+ * How {@link MediaFetcher} counts its HTTP cache in {@link MediaStats}. The counters are global, so every
+ * test compares them before and after.
+ */
+public class MediaFetcherTest {
+
+    private static final String BODY = "not really an image";
+
+    @Rule
+    public TemporaryFolder folder = new TemporaryFolder();
+
+    private MockWebServer server;
+    private MediaFetcher fetcher;
+
+    private long hits;
+    private long revalidations;
+    private long misses;
+    private long bytesSaved;
+
+    @Before
+    public void setUp() throws IOException {
+        server = new MockWebServer();
+        server.start();
+        fetcher = new MediaFetcher(folder.newFolder("http"));
+    }
+
+    @After
+    public void tearDown() throws IOException {
+        server.shutdown();
+    }
+
+    @Test
+    public void freshEntryIsAHit() throws Exception {
+        server.enqueue(new MockResponse().setBody(BODY).addHeader("Cache-Control", "max-age=600"));
+
+        assertEquals(BODY, fetch());
+        markStats();
+        assertEquals(BODY, fetch());
+
+        assertEquals(1, server.getRequestCount());
+        assertStats(1, 0, 0, BODY.length());
+    }
+
+    @Test
+    public void notModifiedIsARevalidation() throws Exception {
+        server.enqueue(new MockResponse().setBody(BODY).addHeader("Cache-Control", "no-cache").addHeader("ETag", "\"v1\""));
+        server.enqueue(new MockResponse().setResponseCode(304).addHeader("ETag", "\"v1\""));
+
+        assertEquals(BODY, fetch());
+        markStats();
+        assertEquals(BODY, fetch());
+
+        server.takeRequest();
+        assertEquals("\"v1\"", server.takeRequest().getHeader("If-None-Match"));
+        assertStats(0, 1, 0, BODY.length());
+    }
+
+    @Test
+    public void changedEntryIsAMiss() throws Exception {
+        String changed = "another image altogether";
+        server.enqueue(new MockResponse().setBody(BODY).addHeader("Cache-Control", "no-cache").addHeader("ETag", "\"v1\""));
+        server.enqueue(new MockResponse().setBody(changed).addHeader("Cache-Control", "no-cache").addHeader("ETag", "\"v2\""));
+
+        assertEquals(BODY, fetch());
+        markStats();
+        assertEquals(changed, fetch());
+
+        server.takeRequest();
+        assertEquals("\"v1\"", server.takeRequest().getHeader("If-None-Match"));
+        assertStats(0, 0, 1, 0);
+    }
+
+    private String fetch() throws IOException {
+        Request request = new Request.Builder().url(server.url("/image.png")).build();
+        return fetcher.fetch(request, new MediaFetcher.BodyReader<String>() {
+            @Override
+            public String read(Response response) throws IOException {
+                return response.body().string();
+            }
+        });
+    }
+
+    private void markStats() {
+        hits = MediaStats.HTTP_CACHE_HITS.get();
+        revalidations = MediaStats.HTTP_CACHE_REVALIDATIONS.get();
+        misses = MediaStats.HTTP_CACHE_MISSES.get();
+        bytesSaved = MediaStats.HTTP_CACHE_BYTES_SAVED.get();
+    }
+
+    private void assertStats(long hitCount, long revalidationCount, long missCount, long savedBytes) {
+        assertEquals("hits", hitCount, MediaStats.HTTP_CACHE_HITS.get() - hits);
+        assertEquals("revalidations", revalidationCount, MediaStats.HTTP_CACHE_REVALIDATIONS.get() - revalidations);
+        assertEquals("misses", missCount, MediaStats.HTTP_CACHE_MISSES.get() - misses);
+        assertEquals("bytes saved", savedBytes, MediaStats.HTTP_CACHE_BYTES_SAVED.get() - bytesSaved);
+    }
+}
@@ -10,6 +10,7 @@
 #import "FluwxLaunchMiniProgramHandler.h"
 #import "FluwxSubscribeMsgHandler.h"
 #import "FluwxAutoDeductHandler.h"
+#import "MediaStats.h"
 
 @implementation FluwxPlugin
 
@@ -103,11 +104,16 @@ FluwxAutoDeductHandler *_fluwxAutoDeductHandler;
     }
 
 
+    if ([getMediaStats isEqualToString:call.method]) {
+        result([MediaStats snapshot]);
+        return;
+    }
+
     if ([@"openWXApp" isEqualToString:call.method]) {
         result(@([WXApi openWXApp]));
         return;
     }
-    if ([call.method hasPrefix:@"share"]) {
+    if ([call.method hasPrefix:@"share"] || [prepareShare isEqualToString:call.method] || [releasePreparedShare isEqualToString:call.method]) {
         [_fluwxShareHandler handleShare:call result:result];
         return;
     } else {
@@ -7,5 +7,7 @@
 extern NSString *const resultDone;
 extern NSString *const resultErrorNeedWeChat;
 extern NSString *const resultMessageNeedWeChat;
+extern NSString *const resultErrorPreparedShareNotFound;
+extern NSString *const resultErrorMediaTooLarge;
 @interface CallResults : NSObject
 @end
\ No newline at end of file
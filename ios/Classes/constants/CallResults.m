@@ -7,6 +7,8 @@
 NSString *const resultDone = @"done";
 NSString *const resultErrorNeedWeChat = @"wxapi not configured";
 NSString *const resultMessageNeedWeChat = @"please config  wxapi first";
+NSString *const resultErrorPreparedShareNotFound = @"prepared share not found";
+NSString *const resultErrorMediaTooLarge = @"media too large";
 @implementation CallResults {
 
 }
@@ -22,6 +22,12 @@ extern NSString *const fluwxKeyMessageExt;
 extern NSString *const fluwxKeyMediaTagName;
 extern NSString *const fluwxKeyMessageAction;
 
+extern NSString *const fluwxKeyMethod;
+extern NSString *const fluwxKeyModel;
+extern NSString *const fluwxKeyId;
+extern NSString *const fluwxKeyTTL;
+extern NSString *const fluwxKeyMediaHosts;
+
 
 extern NSString *const fluwxKeyPlatform;
 extern NSString *const fluwxKeyIOS;
@@ -22,6 +22,12 @@ NSString *const fluwxKeyMessageExt =@"messageExt";
 NSString *const fluwxKeyMediaTagName = @"mediaTagName ";
 NSString *const fluwxKeyMessageAction = @"messageAction";
 
+NSString *const fluwxKeyMethod = @"method";
+NSString *const fluwxKeyModel = @"model";
+NSString *const fluwxKeyId = @"id";
+NSString *const fluwxKeyTTL = @"ttl";
+NSString *const fluwxKeyMediaHosts = @"mediaHosts";
+
 NSString *const fluwxKeyPlatform = @"platform";
 NSString *const fluwxKeyIOS=@"iOS";
 
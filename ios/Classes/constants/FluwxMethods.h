@@ -13,7 +13,12 @@ extern NSString *const shareMusic;
 extern NSString *const shareVideo;
 extern NSString *const shareWebPage;
 extern NSString *const shareMiniProgram;
+
+extern NSString *const prepareShare;
+extern NSString *const sharePrepared;
+extern NSString *const releasePreparedShare;
 extern NSString *const launchMiniProgram;
+extern NSString *const getMediaStats;
 
 @interface FluwxMethods : NSObject
 @end
\ No newline at end of file
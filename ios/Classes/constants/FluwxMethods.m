@@ -13,7 +13,12 @@ NSString *const shareMusic = @"shareMusic";
 NSString *const shareVideo = @"shareVideo";
 NSString *const shareWebPage = @"shareWebPage";
 NSString *const shareMiniProgram = @"shareMiniProgram";
+
+NSString *const prepareShare = @"prepareShare";
+NSString *const sharePrepared = @"sharePrepared";
+NSString *const releasePreparedShare = @"releasePreparedShare";
 NSString *const LaunchMiniProgram = @"launchMiniProgram";
+NSString *const getMediaStats = @"getMediaStats";
 @implementation FluwxMethods {
 
 
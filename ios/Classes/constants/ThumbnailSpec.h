@@ -0,0 +1,32 @@
+//
+// Parameters of the thumbnail pipeline (decode -> resample -> size-budgeted encode).
+// Android reads the same values from ThumbnailSpec.java; change both together. The solver's own
+// parameters live in the core shared with Android, android/src/main/cpp/thumbnail_solver.cpp.
+//
+
+#import <Foundation/Foundation.h>
+
+extern const NSUInteger fluwxCommonThumbLength;
+extern const NSUInteger fluwxMiniProgramThumbLength;
+
+// a JPEG or PNG within the byte budget and at most this long on its longest edge is sent as is.
+extern const NSUInteger fluwxThumbPassthroughMaxEdge;
+// an embedded EXIF thumbnail is used as is only if its longest edge is at least this long...
+extern const NSUInteger fluwxEmbeddedThumbMinEdge;
+// ...and its aspect ratio is within this relative difference of the image's, which rejects letterboxed ones.
+extern const double fluwxEmbeddedThumbAspectTolerance;
+
+// WeChat rejects a shared image longer than this; a longer one is transcoded into it.
+extern const NSUInteger fluwxImageMaxLength;
+// bitmap memory transcoding a shared image may use, whatever its size.
+extern NSUInteger fluwxTranscodeMemoryBudget;
+
+// download caps by what the bytes are for; a longer body is abandoned and the share fails with
+// resultErrorMediaTooLarge. A shared image is transcoded into fluwxImageMaxLength afterwards, so its
+// source may be a few times that. Android has no hd image.
+extern const long long fluwxMaxImageFetchLength;
+extern const long long fluwxMaxThumbnailFetchLength;
+extern const long long fluwxMaxHdImageFetchLength;
+
+@interface ThumbnailSpec : NSObject
+@end
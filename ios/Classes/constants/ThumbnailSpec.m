@@ -0,0 +1,24 @@
+//
+// Parameters of the thumbnail pipeline, see ThumbnailSpec.h.
+//
+
+#import "ThumbnailSpec.h"
+
+const NSUInteger fluwxCommonThumbLength = 32 * 1024;
+const NSUInteger fluwxMiniProgramThumbLength = 120 * 1024;
+
+const NSUInteger fluwxThumbPassthroughMaxEdge = 1024;
+const NSUInteger fluwxEmbeddedThumbMinEdge = 120;
+const double fluwxEmbeddedThumbAspectTolerance = 0.02;
+
+const NSUInteger fluwxImageMaxLength = 10 * 1024 * 1024;
+NSUInteger fluwxTranscodeMemoryBudget = 48 * 1024 * 1024;
+
+const long long fluwxMaxImageFetchLength = 4LL * 10 * 1024 * 1024;
+const long long fluwxMaxThumbnailFetchLength = 10 * 1024 * 1024;
+const long long fluwxMaxHdImageFetchLength = 10 * 1024 * 1024;
+
+@implementation ThumbnailSpec {
+
+}
+@end
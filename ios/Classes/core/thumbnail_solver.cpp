@@ -0,0 +1,6 @@
+//
+// The thumbnail core is shared with Android and lives in android/src/main/cpp; this forwards to it
+// so that the pod compiles the same source.
+//
+
+#include "../../../android/src/main/cpp/thumbnail_solver.cpp"
@@ -12,9 +12,57 @@
 #import "FluwxMethods.h"
 #import "StringUtil.h"
 #import "ThumbnailHelper.h"
+#import "ThumbnailCache.h"
+#import "MediaStats.h"
+#import "MediaFetcher.h"
+#import "ThumbnailSpec.h"
 #import "NSStringWrapper.h"
 
-@implementation FluwxShareHandler
+// 5 minutes.
+static const int64_t fluwxDefaultPreparedShareTTL = 5 * 60 * 1000;
+
+// the scene independent part of a share: the model and its downloaded and compressed media.
+@interface FluwxPreparedShare : NSObject
+@property(nonatomic, copy) NSString *method;
+@property(nonatomic, copy) NSDictionary *arguments;
+@property(nonatomic, strong) NSData *imageData;
+@property(nonatomic, strong) NSData *thumbnailData;
+@property(nonatomic, strong) NSData *hdImageData;
+// the first download that was longer than its cap; the share fails with it.
+@property(nonatomic, strong) NSError *error;
+@end
+
+@implementation FluwxPreparedShare
+
+// media are prepared concurrently, the first error wins.
+- (void)failWithError:(NSError *)error {
+    if (error == nil) {
+        return;
+    }
+    @synchronized (self) {
+        if (_error == nil) {
+            _error = error;
+        }
+    }
+}
+
+- (FlutterError *)flutterError {
+    @synchronized (self) {
+        if (_error == nil) {
+            return nil;
+        }
+        return [FlutterError errorWithCode:resultErrorMediaTooLarge
+                                   message:_error.localizedDescription
+                                   details:@{@"url": [_error.userInfo[NSURLErrorKey] absoluteString] ?: @"",
+                                           @"limit": _error.userInfo[fluwxFetchLimitKey] ?: @0}];
+    }
+}
+@end
+
+@implementation FluwxShareHandler {
+    // only touched on the main queue.
+    NSMutableDictionary<NSString *, FluwxPreparedShare *> *_preparedShares;
+}
 
 CGFloat thumbnailWidth;
 
@@ -25,6 +73,7 @@ NSObject <FlutterPluginRegistrar> *_registrar;
     self = [super init];
     if (self) {
         _registrar = registrar;
+        _preparedShares = [NSMutableDictionary dictionary];
         thumbnailWidth = 150;
     }
 
@@ -33,6 +82,20 @@ NSObject <FlutterPluginRegistrar> *_registrar;
 
 
 - (void)handleShare:(FlutterMethodCall *)call result:(FlutterResult)result {
+    if ([prepareShare isEqualToString:call.method]) {
+        [self prepareShare:call result:result];
+        return;
+    }
+    if ([releasePreparedShare isEqualToString:call.method]) {
+        NSString *shareId = call.arguments[fluwxKeyId];
+        BOOL released = shareId != nil && _preparedShares[shareId] != nil;
+        if (shareId != nil) {
+            [_preparedShares removeObjectForKey:shareId];
+        }
+        result(@(released));
+        return;
+    }
+
     if (!isWeChatRegistered) {
         result([FlutterError errorWithCode:resultErrorNeedWeChat message:resultMessageNeedWeChat details:nil]);
         return;
@@ -43,367 +106,362 @@ NSObject <FlutterPluginRegistrar> *_registrar;
 //        return;
 //    }
 
-    if ([shareText isEqualToString:call.method]) {
-        [self shareText:call result:result];
-    } else if ([shareImage isEqualToString:call.method]) {
-        [self shareImage:call result:result];
-    } else if ([shareWebPage isEqualToString:call.method]) {
-        [self shareWebPage:call result:result];
-    } else if ([shareMusic isEqualToString:call.method]) {
-        [self shareMusic:call result:result];
-    } else if ([shareVideo isEqualToString:call.method]) {
-        [self shareVideo:call result:result];
-    } else if([shareMiniProgram isEqualToString:call.method]){
-        [self shareMiniProgram:call result:result];
+    if ([sharePrepared isEqualToString:call.method]) {
+        [self sharePrepared:call result:result];
+        return;
     }
-
-
-}
-
-- (void)shareText:(FlutterMethodCall *)call result:(FlutterResult)result {
-    NSString *text = call.arguments[fluwxKeyText];
-    NSString *scene = call.arguments[fluwxKeyScene];
-    BOOL done = [WXApiRequestHandler sendText:text InScene:[StringToWeChatScene toScene:scene]];
-    result(@{fluwxKeyPlatform: fluwxKeyIOS, fluwxKeyResult: @(done)});
-}
-
-
-- (void)shareImage:(FlutterMethodCall *)call result:(FlutterResult)result {
-    NSString *imagePath = call.arguments[fluwxKeyImage];
-    if ([imagePath hasPrefix:SCHEMA_ASSETS]) {
-        [self shareAssetImage:call result:result imagePath:imagePath];
-    } else if ([imagePath hasPrefix:SCHEMA_FILE]) {
-        [self shareLocalImage:call result:result imagePath:imagePath];
-    } else {
-        [self shareNetworkImage:call result:result imagePath:imagePath];
+    if (![self isShareMethod:call.method]) {
+        return;
     }
-
-
-}
-
-
-- (void)shareNetworkImage:(FlutterMethodCall *)call result:(FlutterResult)result imagePath:(NSString *)imagePath {
-
-
-    NSString *thumbnail = call.arguments[fluwxKeyThumbnail];
-
-    if ([StringUtil isBlank:thumbnail]) {
-        thumbnail = imagePath;
+    if ([shareText isEqualToString:call.method]) {
+        // nothing to prepare.
+        [self sendPreparedShare:[self prepareShareOfMethod:call.method arguments:call.arguments] scene:nil result:result];
+        return;
     }
 
-
     dispatch_queue_t globalQueue = dispatch_get_global_queue(0, 0);
     dispatch_async(globalQueue, ^{
-
-        NSURL *imageURL = [NSURL URLWithString:imagePath];
-        //下载图片
-        NSData *imageData = [NSData dataWithContentsOfURL:imageURL];
-
-
-        UIImage *thumbnailImage = [self getThumbnail:thumbnail size:32 * 1024];
-
-
+        FluwxPreparedShare *share = [self prepareShareOfMethod:call.method arguments:call.arguments];
         dispatch_async(dispatch_get_main_queue(), ^{
-
-            NSString *scene = call.arguments[fluwxKeyScene];
-            BOOL done = [WXApiRequestHandler sendImageData:imageData
-                                                   TagName:call.arguments[fluwxKeyMediaTagName]
-                                                MessageExt:call.arguments[fluwxKeyMessageExt]
-                                                    Action:call.arguments[fluwxKeyMessageAction]
-                                                ThumbImage:thumbnailImage
-                                                   InScene:[StringToWeChatScene toScene:scene]
-                                                    title:call.arguments[fluwxKeyTitle]
-                                               description:call.arguments[fluwxKeyDescription]
-                                                ];
-            result(@{fluwxKeyPlatform: fluwxKeyIOS, fluwxKeyResult: @(done)});
-
+            FlutterError *error = [share flutterError];
+            if (error != nil) {
+                result(error);
+                return;
+            }
+            [self sendPreparedShare:share scene:nil result:result];
         });
-
     });
-
 }
 
-- (void)shareLocalImage:(FlutterMethodCall *)call result:(FlutterResult)result imagePath:(NSString *)imagePath {
-
-
-    NSString *thumbnail = call.arguments[fluwxKeyThumbnail];
+- (BOOL)isShareMethod:(NSString *)method {
+    return [@[shareText, shareImage, shareWebPage, shareMusic, shareVideo, shareMiniProgram] containsObject:method];
+}
 
-    if ([StringUtil isBlank:thumbnail]) {
-        thumbnail = imagePath;
+// prepares the media of a share model in the background and keeps it under a new id until it is released or
+// its ttl has passed, so that it can be sent to several scenes.
+- (void)prepareShare:(FlutterMethodCall *)call result:(FlutterResult)result {
+    NSString *method = call.arguments[fluwxKeyMethod];
+    NSDictionary *arguments = call.arguments[fluwxKeyModel];
+    if (![self isShareMethod:method] || ![arguments isKindOfClass:[NSDictionary class]]) {
+        result(FlutterMethodNotImplemented);
+        return;
     }
-
+    NSNumber *ttl = call.arguments[fluwxKeyTTL];
+    int64_t ttlMillis = [ttl isKindOfClass:[NSNumber class]] ? ttl.longLongValue : fluwxDefaultPreparedShareTTL;
 
     dispatch_queue_t globalQueue = dispatch_get_global_queue(0, 0);
     dispatch_async(globalQueue, ^{
-
-//        NSURL *imageURL = [NSURL URLWithString:imagePath];
-        NSUInteger startIndex = SCHEMA_FILE.length;
-
-//        int startIndex = SCHEMA_FILE.e
-        NSString *imagePathWithoutUri = [imagePath substringFromIndex:startIndex];
-        //下载图片
-        NSData *imageData = [NSData dataWithContentsOfFile:imagePathWithoutUri];
-
-
-        UIImage *thumbnailImage = [self getThumbnail:thumbnail size:32 * 1024];
-
-
+        FluwxPreparedShare *share = [self prepareShareOfMethod:method arguments:arguments];
         dispatch_async(dispatch_get_main_queue(), ^{
-
-            NSString *scene = call.arguments[fluwxKeyScene];
-            BOOL done = [WXApiRequestHandler sendImageData:imageData
-                                                   TagName:call.arguments[fluwxKeyMediaTagName]
-                                                MessageExt:call.arguments[fluwxKeyMessageExt]
-                                                    Action:call.arguments[fluwxKeyMessageAction]
-                                                ThumbImage:thumbnailImage
-                                                   InScene:[StringToWeChatScene toScene:scene]
-                                                     title:call.arguments[fluwxKeyTitle]
-                                               description:call.arguments[fluwxKeyDescription]
-            ];
-            result(@{fluwxKeyPlatform: fluwxKeyIOS, fluwxKeyResult: @(done)});
-
+            FlutterError *error = [share flutterError];
+            if (error != nil) {
+                result(error);
+                return;
+            }
+            NSString *shareId = [[NSUUID UUID] UUIDString];
+            self->_preparedShares[shareId] = share;
+            dispatch_after(dispatch_time(DISPATCH_TIME_NOW, ttlMillis * NSEC_PER_MSEC), dispatch_get_main_queue(), ^{
+                if (self->_preparedShares[shareId] == share) {
+                    [self->_preparedShares removeObjectForKey:shareId];
+                }
+            });
+            result(shareId);
         });
-
     });
-
 }
 
-
-
-- (void)shareAssetImage:(FlutterMethodCall *)call result:(FlutterResult)result imagePath:(NSString *)imagePath {
-
-
-    NSString *thumbnail = call.arguments[fluwxKeyThumbnail];
-
-    if ([StringUtil isBlank:thumbnail]) {
-        thumbnail = imagePath;
+- (void)sharePrepared:(FlutterMethodCall *)call result:(FlutterResult)result {
+    NSString *shareId = call.arguments[fluwxKeyId];
+    FluwxPreparedShare *share = shareId != nil ? _preparedShares[shareId] : nil;
+    if (share == nil) {
+        result([FlutterError errorWithCode:resultErrorPreparedShareNotFound message:resultErrorPreparedShareNotFound details:shareId]);
+        return;
     }
-
-
-    dispatch_queue_t globalQueue = dispatch_get_global_queue(0, 0);
-    dispatch_async(globalQueue, ^{
-
-        NSData *imageData = [NSData dataWithContentsOfFile:[self readImageFromAssets:imagePath]];
-
-        UIImage *thumbnailImage = [self getThumbnail:thumbnail size:32 * 1024];
-
-        dispatch_async(dispatch_get_main_queue(), ^{
-
-            NSString *scene = call.arguments[fluwxKeyScene];
-//            BOOL done = [WXApiRequestHandler sendImageData:imageData
-//                                                   TagName:call.arguments[fluwxKeyMediaTagName]
-//                                                MessageExt:fluwxKeyMessageExt
-//                                                    Action:fluwxKeyMessageAction
-//                                                ThumbImage:thumbnailImage
-//                                                   InScene:[StringToWeChatScene toScene:scene]];
-            BOOL done  = [WXApiRequestHandler sendImageData:imageData
-                                                    TagName:call.arguments[fluwxKeyMediaTagName]
-                                                   MessageExt:call.arguments[fluwxKeyMessageExt]
-                                                     Action:call.arguments[fluwxKeyMessageAction]
-                                                 ThumbImage:thumbnailImage
-                                                    InScene:[StringToWeChatScene toScene:scene]
-                                                      title:call.arguments[fluwxKeyTitle]
-                                                description:call.arguments[fluwxKeyDescription]];
-            result(@{fluwxKeyPlatform: fluwxKeyIOS, fluwxKeyResult: @(done)});
-
-        });
-
-    });
-
+    NSString *scene = call.arguments[fluwxKeyScene];
+    [self sendPreparedShare:share scene:([scene isKindOfClass:[NSString class]] ? scene : nil) result:result];
 }
 
-
-- (void)shareWebPage:(FlutterMethodCall *)call result:(FlutterResult)result {
-
+// downloads, decoding and compression a share needs; everything that doesn't depend on the scene.
+// Independent media run concurrently, so a share takes as long as its slowest one rather than their sum.
+// A download longer than its cap in ThumbnailSpec.h sets the share's error.
+// synchronous, call it off the main thread.
+- (FluwxPreparedShare *)prepareShareOfMethod:(NSString *)method arguments:(NSDictionary *)arguments {
+    BOOL prewarmed = [MediaStats valueOf:fluwxStatMediaHostsWarmed] > 0;
+    NSDate *start = [NSDate date];
+    FluwxPreparedShare *share = [[FluwxPreparedShare alloc] init];
+    share.method = method;
+    share.arguments = arguments;
+
+    dispatch_group_t group = dispatch_group_create();
     dispatch_queue_t globalQueue = dispatch_get_global_queue(0, 0);
-    dispatch_async(globalQueue, ^{
-
-        NSString *thumbnail = call.arguments[fluwxKeyThumbnail];
-
-        UIImage *thumbnailImage = [self getThumbnail:thumbnail size:32 * 1024];
-
-
-        dispatch_async(dispatch_get_main_queue(), ^{
-            NSString *webPageUrl = call.arguments[@"webPage"];
-            NSString *scene = call.arguments[fluwxKeyScene];
-
-            BOOL done = [WXApiRequestHandler sendLinkURL:webPageUrl
-                                                 TagName:call.arguments[fluwxKeyMediaTagName]
-                                                   Title:call.arguments[fluwxKeyTitle]
-                                             Description:call.arguments[fluwxKeyDescription]
-                                              ThumbImage:thumbnailImage
-                                              MessageExt:call.arguments[fluwxKeyMessageExt]
-                                           MessageAction:call.arguments[fluwxKeyMessageAction]
-                                                 InScene:[StringToWeChatScene toScene:scene]];
-            result(@{fluwxKeyPlatform: fluwxKeyIOS, fluwxKeyResult: @(done)});
 
+    NSString *thumbnail = arguments[fluwxKeyThumbnail];
+    if ([shareImage isEqualToString:method]) {
+        NSString *imagePath = arguments[fluwxKeyImage];
+        // the image is read once per share; a thumbnail of the same path is made from those bytes.
+        BOOL thumbnailFromImage = [StringUtil isBlank:thumbnail] || [thumbnail isEqualToString:imagePath];
+        BOOL networkImage = ![imagePath hasPrefix:SCHEMA_ASSETS] && ![imagePath hasPrefix:SCHEMA_FILE];
+
+        dispatch_group_async(group, globalQueue, ^{
+            NSError *error = nil;
+            NSData *imageData = [self imageDataOfPath:imagePath maxLength:fluwxMaxImageFetchLength error:&error];
+            [share failWithError:error];
+            if (thumbnailFromImage) {
+                if (networkImage) {
+                    share.thumbnailData = [self thumbnailOfContent:imageData size:fluwxCommonThumbLength fromImage:YES];
+                } else {
+                    share.thumbnailData = [self thumbnailOfImageData:imageData];
+                }
+            }
+            if (imageData.length > fluwxImageMaxLength) {
+                imageData = [ThumbnailHelper transcodeImageData:imageData toByte:fluwxImageMaxLength memoryBudget:fluwxTranscodeMemoryBudget];
+            }
+            share.imageData = imageData;
         });
-
-    });
-
-
-}
-
-- (void)shareMusic:(FlutterMethodCall *)call result:(FlutterResult)result {
-    dispatch_queue_t globalQueue = dispatch_get_global_queue(0, 0);
-    dispatch_async(globalQueue, ^{
-
-        NSString *thumbnail = call.arguments[fluwxKeyThumbnail];
-
-        UIImage *thumbnailImage = [self getThumbnail:thumbnail size:32 * 1024];
-
-
-        dispatch_async(dispatch_get_main_queue(), ^{
-
-            NSString *scene = call.arguments[fluwxKeyScene];
-
-            BOOL done = [WXApiRequestHandler sendMusicURL:call.arguments[@"musicUrl"]
-                                                  dataURL:call.arguments[@"musicDataUrl"]
-                                          MusicLowBandUrl:call.arguments[@"musicLowBandUrl"]
-                                      MusicLowBandDataUrl:call.arguments[@"musicLowBandDataUrl"]
-                                                    Title:call.arguments[fluwxKeyTitle]
-                                              Description:call.arguments[fluwxKeyDescription]
-                                               ThumbImage:thumbnailImage
-                                               MessageExt:call.arguments[fluwxKeyMessageExt]
-                                            MessageAction:call.arguments[fluwxKeyMessageAction]
-                                                  TagName:call.arguments[fluwxKeyMediaTagName]
-                                                  InScene:[StringToWeChatScene toScene:scene]];
-            result(@{fluwxKeyPlatform: fluwxKeyIOS, fluwxKeyResult: @(done)});
-
+        if (!thumbnailFromImage) {
+            dispatch_group_async(group, globalQueue, ^{
+                NSError *error = nil;
+                share.thumbnailData = [self getThumbnail:thumbnail size:fluwxCommonThumbLength error:&error];
+                [share failWithError:error];
+            });
+        }
+    } else if ([shareMiniProgram isEqualToString:method]) {
+        NSString *hdImagePath = arguments[@"hdImagePath"];
+        BOOL thumbnailFromHdImage = ![StringUtil isBlank:hdImagePath] && [thumbnail isEqualToString:hdImagePath];
+
+        dispatch_group_async(group, globalQueue, ^{
+            NSError *error = nil;
+            share.hdImageData = [self imageDataOfPath:hdImagePath maxLength:fluwxMaxHdImageFetchLength error:&error];
+            [share failWithError:error];
+            if (!thumbnailFromHdImage || error != nil) {
+                return;
+            }
+            if (share.hdImageData != nil) {
+                // already loaded as the hd image.
+                share.thumbnailData = [self thumbnailOfContent:share.hdImageData size:fluwxMiniProgramThumbLength fromImage:NO];
+            } else {
+                share.thumbnailData = [self getThumbnail:thumbnail size:fluwxMiniProgramThumbLength error:&error];
+                [share failWithError:error];
+            }
         });
+        if (!thumbnailFromHdImage) {
+            dispatch_group_async(group, globalQueue, ^{
+                NSError *error = nil;
+                share.thumbnailData = [self getThumbnail:thumbnail size:fluwxMiniProgramThumbLength error:&error];
+                [share failWithError:error];
+            });
+        }
+    } else if (![shareText isEqualToString:method]) {
+        NSError *error = nil;
+        share.thumbnailData = [self getThumbnail:thumbnail size:fluwxCommonThumbLength error:&error];
+        [share failWithError:error];
+    }
 
-    });
-
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    if (![shareText isEqualToString:method]) {
+        [MediaStats recordFirstShare:(long long) (-[start timeIntervalSinceNow] * 1000) prewarmed:prewarmed];
+    }
+    return share;
 }
 
-- (void)shareVideo:(FlutterMethodCall *)call result:(FlutterResult)result {
-    dispatch_queue_t globalQueue = dispatch_get_global_queue(0, 0);
-    dispatch_async(globalQueue, ^{
-
-        NSString *thumbnail = call.arguments[fluwxKeyThumbnail];
-
-        UIImage *thumbnailImage = [self getThumbnail:thumbnail size:32 * 1024];
-
-
-        dispatch_async(dispatch_get_main_queue(), ^{
-
-            NSString *scene = call.arguments[fluwxKeyScene];
-
-            BOOL done = [WXApiRequestHandler sendVideoURL:call.arguments[@"videoUrl"]
-                                          VideoLowBandUrl:call.arguments[@"videoLowBandUrl"]
-                                                    Title:call.arguments[fluwxKeyTitle]
-                                              Description:call.arguments[fluwxKeyDescription]
-                                               ThumbImage:thumbnailImage
-                                               MessageExt:call.arguments[fluwxKeyMessageExt]
-                                            MessageAction:call.arguments[fluwxKeyMessageAction]
-                                                  TagName:call.arguments[fluwxKeyMediaTagName]
-                                                  InScene:[StringToWeChatScene toScene:scene]];
-            result(@{fluwxKeyPlatform: fluwxKeyIOS, fluwxKeyResult: @(done)});
-
-        });
-
-    });
-
+// maxLength caps a download; error receives the fetcher's error if it was longer.
+- (NSData *)imageDataOfPath:(NSString *)imagePath maxLength:(long long)maxLength error:(NSError **)error {
+    if ([StringUtil isBlank:imagePath]) {
+        return nil;
+    }
+    if ([imagePath hasPrefix:SCHEMA_ASSETS]) {
+        return [NSData dataWithContentsOfFile:[self readImageFromAssets:imagePath]];
+    } else if ([imagePath hasPrefix:SCHEMA_FILE]) {
+        NSUInteger startIndex = SCHEMA_FILE.length;
+        NSString *imagePathWithoutUri = [imagePath substringFromIndex:startIndex];
+        return [NSData dataWithContentsOfFile:imagePathWithoutUri];
+    }
+    //下载图片
+    NSURL *imageURL = [NSURL URLWithString:imagePath];
+    return [[MediaFetcher sharedFetcher] fetchURL:imageURL ifNoneMatch:nil maxLength:maxLength response:NULL error:error];
 }
 
-- (void)shareMiniProgram:(FlutterMethodCall *)call result:(FlutterResult)result {
-    dispatch_queue_t globalQueue = dispatch_get_global_queue(0,0);
-    dispatch_async(globalQueue, ^{
-
-        NSString *thumbnail = call.arguments[fluwxKeyThumbnail];
-
-        UIImage *thumbnailImage = [self getThumbnail:thumbnail size:120 * 1024];
-
-        NSData *hdImageData = nil;
-
-        NSString *hdImagePath = call.arguments[@"hdImagePath"];
-        if (![StringUtil isBlank:hdImagePath]) {
-            if ([hdImagePath hasPrefix:SCHEMA_ASSETS]) {
-                hdImageData = [NSData dataWithContentsOfFile:[self readImageFromAssets:hdImagePath]];
-
-            } else if ([hdImagePath hasPrefix:SCHEMA_FILE]) {
-                NSUInteger startIndex = SCHEMA_FILE.length;
-
-//        int startIndex = SCHEMA_FILE.e
-                NSString *imagePathWithoutUri = [hdImagePath substringFromIndex:startIndex];
-                hdImageData = [NSData dataWithContentsOfFile:imagePathWithoutUri];
-            } else {
-                NSURL *hdImageURL = [NSURL URLWithString:hdImagePath];
-                hdImageData = [NSData dataWithContentsOfURL:hdImageURL];
-
-
-            }
-
+// builds the message from prepared media and sends it. A non nil scene overrides the scene of the share model.
+- (void)sendPreparedShare:(FluwxPreparedShare *)share scene:(NSString *)sceneOverride result:(FlutterResult)result {
+    NSDictionary *arguments = share.arguments;
+    NSString *scene = sceneOverride != nil ? sceneOverride : arguments[fluwxKeyScene];
+    enum WXScene wxScene = [StringToWeChatScene toScene:scene];
+    BOOL done = NO;
+
+    if ([shareText isEqualToString:share.method]) {
+        done = [WXApiRequestHandler sendText:arguments[fluwxKeyText] InScene:wxScene];
+    } else if ([shareImage isEqualToString:share.method]) {
+        done = [WXApiRequestHandler sendImageData:share.imageData
+                                          TagName:arguments[fluwxKeyMediaTagName]
+                                       MessageExt:arguments[fluwxKeyMessageExt]
+                                           Action:arguments[fluwxKeyMessageAction]
+                                        ThumbData:share.thumbnailData
+                                          InScene:wxScene
+                                            title:arguments[fluwxKeyTitle]
+                                      description:arguments[fluwxKeyDescription]];
+    } else if ([shareWebPage isEqualToString:share.method]) {
+        done = [WXApiRequestHandler sendLinkURL:arguments[@"webPage"]
+                                        TagName:arguments[fluwxKeyMediaTagName]
+                                          Title:arguments[fluwxKeyTitle]
+                                    Description:arguments[fluwxKeyDescription]
+                                      ThumbData:share.thumbnailData
+                                     MessageExt:arguments[fluwxKeyMessageExt]
+                                  MessageAction:arguments[fluwxKeyMessageAction]
+                                        InScene:wxScene];
+    } else if ([shareMusic isEqualToString:share.method]) {
+        done = [WXApiRequestHandler sendMusicURL:arguments[@"musicUrl"]
+                                         dataURL:arguments[@"musicDataUrl"]
+                                 MusicLowBandUrl:arguments[@"musicLowBandUrl"]
+                             MusicLowBandDataUrl:arguments[@"musicLowBandDataUrl"]
+                                           Title:arguments[fluwxKeyTitle]
+                                     Description:arguments[fluwxKeyDescription]
+                                       ThumbData:share.thumbnailData
+                                      MessageExt:arguments[fluwxKeyMessageExt]
+                                   MessageAction:arguments[fluwxKeyMessageAction]
+                                         TagName:arguments[fluwxKeyMediaTagName]
+                                         InScene:wxScene];
+    } else if ([shareVideo isEqualToString:share.method]) {
+        done = [WXApiRequestHandler sendVideoURL:arguments[@"videoUrl"]
+                                 VideoLowBandUrl:arguments[@"videoLowBandUrl"]
+                                           Title:arguments[fluwxKeyTitle]
+                                     Description:arguments[fluwxKeyDescription]
+                                       ThumbData:share.thumbnailData
+                                      MessageExt:arguments[fluwxKeyMessageExt]
+                                   MessageAction:arguments[fluwxKeyMessageAction]
+                                         TagName:arguments[fluwxKeyMediaTagName]
+                                         InScene:wxScene];
+    } else if ([shareMiniProgram isEqualToString:share.method]) {
+        NSNumber *typeInt = arguments[@"miniProgramType"];
+        WXMiniProgramType miniProgramType = WXMiniProgramTypeRelease;
+        if([typeInt isEqualToNumber:@1]){
+            miniProgramType =WXMiniProgramTypeTest;
+        } else if([typeInt isEqualToNumber:@2]){
+            miniProgramType = WXMiniProgramTypePreview;
         }
 
-        dispatch_async(dispatch_get_main_queue(), ^{
-
-            NSString *scene = call.arguments[fluwxKeyScene];
-
-            NSNumber *typeInt = call.arguments[@"miniProgramType"];
-            WXMiniProgramType miniProgramType = WXMiniProgramTypeRelease;
-            if([typeInt isEqualToNumber:@1]){
-                miniProgramType =WXMiniProgramTypeTest;
-            } else if([typeInt isEqualToNumber:@2]){
-                miniProgramType = WXMiniProgramTypePreview;
-            }
-
-            BOOL done = [WXApiRequestHandler sendMiniProgramWebpageUrl:call.arguments[@"webPageUrl"]
-                                                              userName:call.arguments[@"userName"]
-                                                                  path:call.arguments[@"path"]
-                                                                 title:call.arguments[fluwxKeyTitle]
-                                                           Description:call.arguments[fluwxKeyDescription]
-                                                            ThumbImage:thumbnailImage
-                                                           hdImageData:hdImageData
-                                                       withShareTicket:[call.arguments[@"withShareTicket"] boolValue]
-                                                       miniProgramType:miniProgramType
-                                                            MessageExt:call.arguments[fluwxKeyMessageExt]
-                                                         MessageAction:call.arguments[fluwxKeyMessageAction]
-                                                               TagName:call.arguments[fluwxKeyMediaTagName]
-                                                               InScene:[StringToWeChatScene toScene:scene]];
-            result(@{fluwxKeyPlatform: fluwxKeyIOS, fluwxKeyResult: @(done)});
-
-        });
-
-    });
-
+        done = [WXApiRequestHandler sendMiniProgramWebpageUrl:arguments[@"webPageUrl"]
+                                                     userName:arguments[@"userName"]
+                                                         path:arguments[@"path"]
+                                                        title:arguments[fluwxKeyTitle]
+                                                  Description:arguments[fluwxKeyDescription]
+                                                    ThumbData:share.thumbnailData
+                                                  hdImageData:share.hdImageData
+                                              withShareTicket:[arguments[@"withShareTicket"] boolValue]
+                                              miniProgramType:miniProgramType
+                                                   MessageExt:arguments[fluwxKeyMessageExt]
+                                                MessageAction:arguments[fluwxKeyMessageAction]
+                                                      TagName:arguments[fluwxKeyMediaTagName]
+                                                      InScene:wxScene];
+    }
+    result(@{fluwxKeyPlatform: fluwxKeyIOS, fluwxKeyResult: @(done)});
 }
 
-- (UIImage *)getThumbnail:(NSString *)thumbnail size:(NSUInteger)size {
-
-
-    UIImage *thumbnailImage = nil;
+// error receives the fetcher's error if the source was longer than fluwxMaxThumbnailFetchLength.
+- (NSData *)getThumbnail:(NSString *)thumbnail size:(NSUInteger)size error:(NSError **)error {
 
     if ([StringUtil isBlank:thumbnail]) {
         return nil;
     }
 
-
+    NSString *path = nil;
     if ([thumbnail hasPrefix:SCHEMA_ASSETS]) {
-        NSData *imageData2 = [NSData dataWithContentsOfFile:[self readImageFromAssets:thumbnail]];
-        UIImage *tmp = [UIImage imageWithData:imageData2];
-        thumbnailImage = [ThumbnailHelper compressImage:tmp toByte:size isPNG:FALSE];
-
+        path = [self readImageFromAssets:thumbnail];
     } else if ([thumbnail hasPrefix:SCHEMA_FILE]) {
         NSUInteger startIndex = SCHEMA_FILE.length;
+        path = [thumbnail substringFromIndex:startIndex];
+    }
 
-//        int startIndex = SCHEMA_FILE.e
-        NSString *thumbnailPathWithoutUri = [thumbnail substringFromIndex:startIndex];
-        NSData *thumbnailData = [NSData dataWithContentsOfFile:thumbnailPathWithoutUri];
-        UIImage *tmp = [UIImage imageWithData:thumbnailData];
-        thumbnailImage = [ThumbnailHelper compressImage:tmp toByte:size isPNG:FALSE];
-    } else {
-        NSURL *thumbnailURL = [NSURL URLWithString:thumbnail];
-        NSData *thumbnailData = [NSData dataWithContentsOfURL:thumbnailURL];
+    ThumbnailCache *cache = [ThumbnailCache sharedCache];
+    NSString *cacheKey = [ThumbnailCache keyForImage:(path != nil ? path : thumbnail) size:size embedded:NO];
+    ThumbnailCacheEntry *entry = [cache entryForKey:cacheKey];
 
-        UIImage *tmp = [UIImage imageWithData:thumbnailData];
-        thumbnailImage = [ThumbnailHelper compressImage:tmp toByte:size isPNG:FALSE];
+    if (path != nil) {
+        NSString *validator = [ThumbnailCache validatorOfFileAtPath:path];
+        if (entry != nil && validator != nil && [entry.validator isEqualToString:validator]) {
+            return entry.data;
+        }
+        NSData *thumbnailData = [self thumbnailOfFile:path size:size];
+        [cache storeData:thumbnailData forKey:cacheKey validator:validator expiresAt:[NSDate distantFuture]];
+        return thumbnailData;
+    }
 
+    if (entry != nil && [entry.expiresAt timeIntervalSinceNow] > 0) {
+        return entry.data;
+    }
+    NSHTTPURLResponse *response = nil;
+    NSData *imageData = [[MediaFetcher sharedFetcher] fetchURL:[NSURL URLWithString:thumbnail]
+                                                          ifNoneMatch:entry.validator
+                                                            maxLength:fluwxMaxThumbnailFetchLength
+                                                             response:&response
+                                                                error:error];
+    if (imageData == nil && error != NULL && *error != nil) {
+        return nil;
     }
+    NSDate *expiresAt = [ThumbnailCache expiryOfResponse:response];
+    if (entry != nil && response.statusCode == 304) {
+        [cache storeData:entry.data forKey:cacheKey validator:entry.validator expiresAt:expiresAt];
+        return entry.data;
+    }
+    NSData *thumbnailData = [self thumbnailOfContent:imageData size:size fromImage:NO];
+    NSString *etag = [ThumbnailCache ETagOfResponse:response];
+    if (etag != nil || [expiresAt timeIntervalSinceNow] > 0) {
+        [cache storeData:thumbnailData forKey:cacheKey validator:etag expiresAt:expiresAt];
+    }
+    return thumbnailData;
+}
 
+- (NSData *)thumbnailOfFile:(NSString *)path size:(NSUInteger)size {
+    NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:path error:nil];
+    if (attributes != nil && [attributes fileSize] <= size) {
+        // small files are read once; they either pass through or are decoded from memory.
+        return [self thumbnailOfData:[NSData dataWithContentsOfFile:path] size:size];
+    }
+    CGFloat maxPixelSize = [ThumbnailHelper maxPixelSizeForByteBudget:size];
+    UIImage *image = [ThumbnailHelper downsampledImageWithContentsOfFile:path maxPixelSize:maxPixelSize];
+    return [ThumbnailHelper compressImage:image toByte:size encodeCount:NULL];
+}
+
+- (NSData *)thumbnailOfData:(NSData *)imageData size:(NSUInteger)size {
+    NSData *thumbnailData = [ThumbnailHelper passthroughThumbnailOfData:imageData toByte:size];
+    if (thumbnailData != nil) {
+        return thumbnailData;
+    }
+    CGFloat maxPixelSize = [ThumbnailHelper maxPixelSizeForByteBudget:size];
+    UIImage *image = [ThumbnailHelper downsampledImageWithData:imageData maxPixelSize:maxPixelSize];
+    return [ThumbnailHelper compressImage:image toByte:size encodeCount:NULL];
+}
+
+// the same bytes served under different URLs share one thumbnail. fromImage: imageData is the shared image itself,
+// so its embedded EXIF thumbnail may be used.
+- (NSData *)thumbnailOfContent:(NSData *)imageData size:(NSUInteger)size fromImage:(BOOL)fromImage {
+    if (imageData.length == 0) {
+        return nil;
+    }
+    ThumbnailCache *cache = [ThumbnailCache sharedCache];
+    NSString *contentKey = [ThumbnailCache keyForContent:imageData size:size embedded:fromImage];
+    ThumbnailCacheEntry *entry = [cache entryForKey:contentKey];
+    if (entry != nil) {
+        [MediaStats increment:fluwxStatThumbnailDedupHits];
+        return entry.data;
+    }
+    [MediaStats increment:fluwxStatThumbnailDedupMisses];
 
-    return thumbnailImage;
+    NSData *thumbnailData = fromImage ? [self thumbnailOfImageData:imageData] : [self thumbnailOfData:imageData size:size];
+    [cache storeData:thumbnailData forKey:contentKey validator:nil expiresAt:[NSDate distantFuture]];
+    return thumbnailData;
+}
 
+// thumbnail of a shared image when none was given: the image itself if small enough, its embedded EXIF thumbnail
+// if usable, otherwise downsampled from imageData.
+- (NSData *)thumbnailOfImageData:(NSData *)imageData {
+    NSData *thumbnailData = [ThumbnailHelper passthroughThumbnailOfData:imageData toByte:fluwxCommonThumbLength];
+    if (thumbnailData == nil) {
+        thumbnailData = [ThumbnailHelper embeddedThumbnailOfData:imageData toByte:fluwxCommonThumbLength];
+    }
+    if (thumbnailData != nil) {
+        return thumbnailData;
+    }
+    return [self thumbnailOfData:imageData size:fluwxCommonThumbLength];
 }
 
 - (NSString *)readImageFromAssets:(NSString *)imagePath {
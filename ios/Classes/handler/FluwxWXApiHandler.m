@@ -9,6 +9,7 @@
 #import "CallResults.h"
 #import "WXApi.h"
 #import "FluwxKeys.h"
+#import "MediaFetcher.h"
 
 @implementation FluwxWXApiHandler
 - (void)registerApp:(FlutterMethodCall *)call result:(FlutterResult)result {
@@ -17,6 +18,12 @@
         return;
     }
 
+    // in the background; the first share then finds connections to its CDN open.
+    NSArray *mediaHosts = call.arguments[fluwxKeyMediaHosts];
+    if ([mediaHosts isKindOfClass:[NSArray class]] && mediaHosts.count > 0) {
+        [[MediaFetcher sharedFetcher] prewarmHosts:mediaHosts];
+    }
+
     if (isWeChatRegistered) {
         result(@{fluwxKeyPlatform: fluwxKeyIOS, fluwxKeyResult: @YES});
         return;
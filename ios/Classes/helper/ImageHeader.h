@@ -0,0 +1,29 @@
+//
+// Format, dimensions, EXIF orientation and embedded EXIF thumbnail of a JPEG or PNG,
+// read from its header without decoding any pixels. Mirrors ImageHeader.java.
+//
+
+#import <Foundation/Foundation.h>
+
+typedef NS_ENUM(NSInteger, ImageHeaderFormat) {
+    ImageHeaderFormatUnknown = 0,
+    ImageHeaderFormatJPEG,
+    ImageHeaderFormatPNG,
+};
+
+@interface ImageHeader : NSObject
+
+@property(nonatomic, readonly) ImageHeaderFormat format;
+// stored size, before orientation is applied. 0 if unknown.
+@property(nonatomic, readonly) NSUInteger width;
+@property(nonatomic, readonly) NSUInteger height;
+// EXIF orientation, 1 to 8.
+@property(nonatomic, readonly) NSUInteger orientation;
+// range of the JPEG thumbnail stored in EXIF IFD1 within the parsed data, location is NSNotFound if there is none.
+// Stored unrotated, orientation applies to it as well.
+@property(nonatomic, readonly) NSRange thumbnailRange;
+
++ (instancetype)headerWithData:(NSData *)data;
+
+- (BOOL)hasSize;
+@end
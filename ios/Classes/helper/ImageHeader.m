@@ -0,0 +1,182 @@
+//
+// Format, dimensions, EXIF orientation and embedded EXIF thumbnail of a JPEG or PNG, see ImageHeader.h.
+//
+
+#import "ImageHeader.h"
+
+static const uint16_t tagOrientation = 0x0112;
+static const uint16_t tagThumbnailOffset = 0x0201;
+static const uint16_t tagThumbnailLength = 0x0202;
+
+@interface ImageHeader ()
+@property(nonatomic, readwrite) ImageHeaderFormat format;
+@property(nonatomic, readwrite) NSUInteger width;
+@property(nonatomic, readwrite) NSUInteger height;
+@property(nonatomic, readwrite) NSUInteger orientation;
+@property(nonatomic, readwrite) NSRange thumbnailRange;
+@end
+
+@implementation ImageHeader {
+    const uint8_t *_bytes;
+    NSUInteger _length;
+    // TIFF header of the EXIF segment being parsed
+    NSUInteger _tiffBase;
+    NSUInteger _tiffLength;
+    BOOL _littleEndian;
+}
+
++ (instancetype)headerWithData:(NSData *)data {
+    ImageHeader *header = [[ImageHeader alloc] init];
+    header.format = ImageHeaderFormatUnknown;
+    header.orientation = 1;
+    header.thumbnailRange = NSMakeRange(NSNotFound, 0);
+    header->_bytes = data.bytes;
+    header->_length = data.length;
+
+    if (header->_length >= 2 && header->_bytes[0] == 0xFF && header->_bytes[1] == 0xD8) {
+        header.format = ImageHeaderFormatJPEG;
+        [header parseJPEG];
+    } else if (header->_length >= 24 && memcmp(header->_bytes, "\x89PNG", 4) == 0) {
+        [header parsePNG];
+    }
+    header->_bytes = NULL;
+    return header;
+}
+
+- (BOOL)hasSize {
+    return self.width > 0 && self.height > 0;
+}
+
+- (uint16_t)readBigEndianShort:(NSUInteger)position {
+    return (uint16_t) (_bytes[position] << 8 | _bytes[position + 1]);
+}
+
+- (uint32_t)readBigEndianInt:(NSUInteger)position {
+    return (uint32_t) [self readBigEndianShort:position] << 16 | [self readBigEndianShort:position + 2];
+}
+
+- (void)parsePNG {
+    self.format = ImageHeaderFormatPNG;
+    // IHDR
+    if (memcmp(_bytes + 12, "IHDR", 4) != 0) {
+        return;
+    }
+    self.width = [self readBigEndianInt:16];
+    self.height = [self readBigEndianInt:20];
+}
+
+- (void)parseJPEG {
+    NSUInteger position = 2;
+    while (position < _length) {
+        if (_bytes[position] != 0xFF) {
+            return;
+        }
+        while (position < _length && _bytes[position] == 0xFF) {
+            position++;
+        }
+        if (position >= _length) {
+            return;
+        }
+        uint8_t marker = _bytes[position++];
+
+        // start of scan or end of image: no more header segments.
+        if (marker == 0xDA || marker == 0xD9) {
+            return;
+        }
+        // markers without a payload.
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+            continue;
+        }
+
+        if (position + 2 > _length) {
+            return;
+        }
+        NSUInteger segmentLength = [self readBigEndianShort:position];
+        if (segmentLength < 2 || position + segmentLength > _length) {
+            return;
+        }
+        NSUInteger segment = position + 2;
+        NSUInteger length = segmentLength - 2;
+
+        if (marker == 0xE1) {
+            [self parseExif:segment length:length];
+        } else if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+            if (length >= 5) {
+                self.height = [self readBigEndianShort:segment + 1];
+                self.width = [self readBigEndianShort:segment + 3];
+            }
+            // SOF is the last segment needed.
+            return;
+        }
+        position += segmentLength;
+    }
+}
+
+- (void)parseExif:(NSUInteger)segment length:(NSUInteger)length {
+    if (length < 14 || memcmp(_bytes + segment, "Exif", 4) != 0) {
+        return;
+    }
+    _tiffBase = segment + 6;
+    _tiffLength = length - 6;
+    if (memcmp(_bytes + _tiffBase, "II", 2) == 0) {
+        _littleEndian = YES;
+    } else if (memcmp(_bytes + _tiffBase, "MM", 2) == 0) {
+        _littleEndian = NO;
+    } else {
+        return;
+    }
+
+    uint32_t ifd0 = [self tiffInt:4];
+    uint16_t entryCount = [self tiffShort:ifd0];
+    for (NSUInteger i = 0; i < entryCount; i++) {
+        NSUInteger entry = ifd0 + 2 + i * 12;
+        if ([self tiffShort:entry] == tagOrientation) {
+            uint16_t value = [self tiffShort:entry + 8];
+            if (value >= 1 && value <= 8) {
+                self.orientation = value;
+            }
+        }
+    }
+
+    // IFD1 describes the embedded thumbnail.
+    uint32_t ifd1 = [self tiffInt:ifd0 + 2 + entryCount * 12];
+    if (ifd1 == 0) {
+        return;
+    }
+    uint32_t thumbnailOffset = 0;
+    uint32_t thumbnailLength = 0;
+    entryCount = [self tiffShort:ifd1];
+    for (NSUInteger i = 0; i < entryCount; i++) {
+        NSUInteger entry = ifd1 + 2 + i * 12;
+        uint16_t tag = [self tiffShort:entry];
+        if (tag == tagThumbnailOffset) {
+            thumbnailOffset = [self tiffInt:entry + 8];
+        } else if (tag == tagThumbnailLength) {
+            thumbnailLength = [self tiffInt:entry + 8];
+        }
+    }
+    if (thumbnailOffset > 0 && thumbnailLength > 2 && (NSUInteger) thumbnailOffset + thumbnailLength <= _tiffLength
+            && _bytes[_tiffBase + thumbnailOffset] == 0xFF && _bytes[_tiffBase + thumbnailOffset + 1] == 0xD8) {
+        self.thumbnailRange = NSMakeRange(_tiffBase + thumbnailOffset, thumbnailLength);
+    }
+}
+
+// bounds checked reads, offsets relative to the TIFF header. Out of range reads return 0.
+- (uint16_t)tiffShort:(NSUInteger)offset {
+    if (offset + 2 > _tiffLength) {
+        return 0;
+    }
+    const uint8_t *p = _bytes + _tiffBase + offset;
+    return _littleEndian ? (uint16_t) (p[1] << 8 | p[0]) : (uint16_t) (p[0] << 8 | p[1]);
+}
+
+- (uint32_t)tiffInt:(NSUInteger)offset {
+    if (offset + 4 > _tiffLength) {
+        return 0;
+    }
+    uint32_t high = [self tiffShort:_littleEndian ? offset + 2 : offset];
+    uint32_t low = [self tiffShort:_littleEndian ? offset : offset + 2];
+    return high << 16 | low;
+}
+
+@end
@@ -0,0 +1,45 @@
+//
+// The one NSURLSession every download of share media goes through. Mirrors MediaFetcher.java.
+// Connections are kept alive by one session, so the image and the thumbnail of a share, and the next
+// share from the same CDN, reuse a connection and its TLS session; HTTP/2 is negotiated where the
+// server offers it and multiplexes concurrent requests to a host on one connection. Bodies stream in
+// through the session delegate.
+// Responses are kept in a bounded NSURLCache of its own that honours Cache-Control: a fresh entry is
+// used without a request, a stale one is revalidated with its ETag or Last-Modified, so an unchanged
+// image costs a 304 instead of its body. Hits, revalidations, misses and the bytes they saved are
+// counted in MediaStats.
+// Every fetch has a byte cap; a body longer than that is cancelled as soon as its Content-Length, or
+// the count of bytes received so far if it has none, says so.
+// Media hosts the app names at registerApp are warmed: a HEAD request to each resolves it and leaves a
+// connection, TLS session included, open in the session for the first share. The system closes it once
+// it has been idle for a while, as it does with every connection of the session.
+//
+
+#import <Foundation/Foundation.h>
+
+// error of a fetch whose body was longer than its cap. userInfo has the URL under NSURLErrorKey
+// and the cap under fluwxFetchLimitKey.
+extern NSString *const fluwxFetchErrorDomain;
+extern NSString *const fluwxFetchLimitKey;
+
+typedef NS_ENUM(NSInteger, FluwxFetchError) {
+    FluwxFetchErrorTooLarge = 1,
+};
+
+
+@interface MediaFetcher : NSObject
++ (instancetype)sharedFetcher;
+
+// cacheDirectory: path of the HTTP cache, relative to Caches; nil for no cache.
+- (instancetype)initWithCacheDirectory:(NSString *)cacheDirectory;
+
+// sets up a connection to each of hosts; returns at once, the requests run in the background. A host is a
+// name such as cdn.example.com, warmed over HTTPS, or a URL, whose scheme and port are used.
+- (void)prewarmHosts:(NSArray<NSString *> *)hosts;
+
+// synchronous, call it off the main thread. With etag, an unchanged resource is answered with 304 and no data.
+// nil if the fetch failed or the status isn't 2xx; response receives the HTTP response, if there is one.
+// maxLength: one of the caps in ThumbnailSpec.h. error receives a FluwxFetchErrorTooLarge if the body
+// was longer, and is left alone on any other failure.
+- (NSData *)fetchURL:(NSURL *)url ifNoneMatch:(NSString *)etag maxLength:(long long)maxLength response:(NSHTTPURLResponse **)response error:(NSError **)error;
+@end
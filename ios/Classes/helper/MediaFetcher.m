@@ -0,0 +1,230 @@
+//
+// Shared fetcher of share media, see MediaFetcher.h.
+//
+
+#import "MediaFetcher.h"
+#import "MediaStats.h"
+
+// NSURLSession has no separate connect timeout, the request timeout is the longest a connection,
+// or a response that stopped delivering data, may stay idle.
+static const NSTimeInterval fluwxFetchRequestTimeout = 20;
+static const NSTimeInterval fluwxFetchResourceTimeout = 120;
+static const NSInteger fluwxFetchMaxConnectionsPerHost = 4;
+static NSString *const fluwxFetchCacheDirectory = @"fluwx_http";
+static const NSUInteger fluwxFetchCacheMemoryCapacity = 4 * 1024 * 1024;
+static const NSUInteger fluwxFetchCacheDiskCapacity = 50 * 1024 * 1024;
+
+NSString *const fluwxFetchErrorDomain = @"com.jarvanmo.fluwx.fetch";
+NSString *const fluwxFetchLimitKey = @"limit";
+
+
+@interface FluwxFetch : NSObject
+@property(nonatomic, strong) NSURLResponse *response;
+@property(nonatomic, strong) NSMutableData *data;
+@property(nonatomic, strong) NSError *error;
+@property(nonatomic, assign) long long maxLength;
+// cancelled because the body was longer than maxLength.
+@property(nonatomic, assign) BOOL tooLarge;
+// the MediaStats counter of how the HTTP cache served it, from the task's metrics; nil before iOS 10.
+@property(nonatomic, copy) NSString *cacheUse;
+// the caller made the request conditional itself, it bypasses the cache and isn't counted.
+@property(nonatomic, assign) BOOL conditional;
+@property(nonatomic, strong) dispatch_semaphore_t done;
+@end
+
+@implementation FluwxFetch
+@end
+
+
+@interface MediaFetcher () <NSURLSessionDataDelegate>
+@end
+
+@implementation MediaFetcher {
+    NSURLSession *_session;
+    // by task identifier, guarded by @synchronized (self).
+    NSMutableDictionary<NSNumber *, FluwxFetch *> *_fetches;
+}
+
++ (instancetype)sharedFetcher {
+    static MediaFetcher *fetcher;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        fetcher = [[MediaFetcher alloc] initWithCacheDirectory:fluwxFetchCacheDirectory];
+    });
+    return fetcher;
+}
+
+- (instancetype)initWithCacheDirectory:(NSString *)cacheDirectory {
+    self = [super init];
+    if (self) {
+        _fetches = [NSMutableDictionary dictionary];
+        NSURLSessionConfiguration *configuration = [NSURLSessionConfiguration defaultSessionConfiguration];
+        configuration.timeoutIntervalForRequest = fluwxFetchRequestTimeout;
+        configuration.timeoutIntervalForResource = fluwxFetchResourceTimeout;
+        configuration.HTTPMaximumConnectionsPerHost = fluwxFetchMaxConnectionsPerHost;
+        configuration.requestCachePolicy = NSURLRequestUseProtocolCachePolicy;
+        configuration.URLCache = cacheDirectory == nil ? nil : [[NSURLCache alloc] initWithMemoryCapacity:fluwxFetchCacheMemoryCapacity
+                                                                                                diskCapacity:fluwxFetchCacheDiskCapacity
+                                                                                                    diskPath:cacheDirectory];
+        NSOperationQueue *delegateQueue = [[NSOperationQueue alloc] init];
+        delegateQueue.maxConcurrentOperationCount = 1;
+        _session = [NSURLSession sessionWithConfiguration:configuration delegate:self delegateQueue:delegateQueue];
+    }
+    return self;
+}
+
+- (NSData *)fetchURL:(NSURL *)url ifNoneMatch:(NSString *)etag maxLength:(long long)maxLength response:(NSHTTPURLResponse **)response error:(NSError **)error {
+    if (response) {
+        *response = nil;
+    }
+    if (url == nil) {
+        return nil;
+    }
+    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:url];
+    if (etag != nil) {
+        request.cachePolicy = NSURLRequestReloadIgnoringLocalCacheData;
+        [request setValue:etag forHTTPHeaderField:@"If-None-Match"];
+    }
+
+    FluwxFetch *fetch = [[FluwxFetch alloc] init];
+    fetch.done = dispatch_semaphore_create(0);
+    fetch.conditional = etag != nil;
+    fetch.maxLength = maxLength;
+    NSURLSessionDataTask *task = [_session dataTaskWithRequest:request];
+    @synchronized (self) {
+        _fetches[@(task.taskIdentifier)] = fetch;
+    }
+    [task resume];
+    dispatch_semaphore_wait(fetch.done, DISPATCH_TIME_FOREVER);
+
+    NSHTTPURLResponse *httpResponse = [fetch.response isKindOfClass:[NSHTTPURLResponse class]] ? (NSHTTPURLResponse *) fetch.response : nil;
+    if (response) {
+        *response = httpResponse;
+    }
+    [self countCacheUseOfFetch:fetch];
+    if (fetch.tooLarge) {
+        [MediaStats increment:fluwxStatFetchesAborted];
+        if (error) {
+            *error = [NSError errorWithDomain:fluwxFetchErrorDomain
+                                         code:FluwxFetchErrorTooLarge
+                                     userInfo:@{NSURLErrorKey: url,
+                                             fluwxFetchLimitKey: @(maxLength),
+                                             NSLocalizedDescriptionKey: [NSString stringWithFormat:@"%@ is longer than %lld bytes", url, maxLength]}];
+        }
+        return nil;
+    }
+    if (fetch.error != nil) {
+        return nil;
+    }
+    if (httpResponse != nil && (httpResponse.statusCode < 200 || httpResponse.statusCode >= 300)) {
+        return nil;
+    }
+    return fetch.data;
+}
+
+- (void)prewarmHosts:(NSArray<NSString *> *)hosts {
+    for (NSString *host in hosts) {
+        if (![host isKindOfClass:[NSString class]]) {
+            continue;
+        }
+        NSURL *hostURL = [NSURL URLWithString:[host containsString:@"://"] ? host : [@"https://" stringByAppendingString:host]];
+        NSURL *url = hostURL.host == nil ? nil : [NSURL URLWithString:@"/" relativeToURL:hostURL];
+        if (url == nil) {
+            continue;
+        }
+        // HEAD isn't cached, so it always goes to the network. Whatever the status, the connection is set up.
+        NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:url];
+        request.HTTPMethod = @"HEAD";
+        request.cachePolicy = NSURLRequestReloadIgnoringLocalCacheData;
+        NSURLSessionDataTask *task = [_session dataTaskWithRequest:request completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+            if (error == nil) {
+                [MediaStats increment:fluwxStatMediaHostsWarmed];
+            }
+        }];
+        [task resume];
+    }
+}
+
+- (void)countCacheUseOfFetch:(FluwxFetch *)fetch {
+    if (fetch.conditional || fetch.cacheUse == nil || fetch.error != nil) {
+        return;
+    }
+    [MediaStats increment:fetch.cacheUse];
+    if (![fetch.cacheUse isEqualToString:fluwxStatHttpCacheMisses]) {
+        [MediaStats add:fetch.data.length to:fluwxStatHttpCacheBytesSaved];
+    }
+}
+
+- (FluwxFetch *)fetchOfTask:(NSURLSessionTask *)task {
+    @synchronized (self) {
+        return _fetches[@(task.taskIdentifier)];
+    }
+}
+
+#pragma mark - NSURLSessionDataDelegate
+
+- (void)URLSession:(NSURLSession *)session dataTask:(NSURLSessionDataTask *)dataTask didReceiveResponse:(NSURLResponse *)response completionHandler:(void (^)(NSURLSessionResponseDisposition))completionHandler {
+    FluwxFetch *fetch = [self fetchOfTask:dataTask];
+    if (fetch == nil) {
+        completionHandler(NSURLSessionResponseAllow);
+        return;
+    }
+    fetch.response = response;
+    long long expectedLength = response.expectedContentLength;
+    if (expectedLength > fetch.maxLength) {
+        fetch.tooLarge = YES;
+        completionHandler(NSURLSessionResponseCancel);
+        return;
+    }
+    fetch.data = [NSMutableData dataWithCapacity:expectedLength > 0 && expectedLength <= NSIntegerMax ? (NSUInteger) expectedLength : 0];
+    completionHandler(NSURLSessionResponseAllow);
+}
+
+- (void)URLSession:(NSURLSession *)session dataTask:(NSURLSessionDataTask *)dataTask didReceiveData:(NSData *)data {
+    FluwxFetch *fetch = [self fetchOfTask:dataTask];
+    if (fetch.tooLarge) {
+        return;
+    }
+    if ((long long) (fetch.data.length + data.length) > fetch.maxLength) {
+        // no Content-Length, or more than it said; the rest isn't received.
+        fetch.tooLarge = YES;
+        fetch.data = nil;
+        [dataTask cancel];
+        return;
+    }
+    // data may be a list of buffers; append them one by one instead of flattening them first.
+    [data enumerateByteRangesUsingBlock:^(const void *bytes, NSRange byteRange, BOOL *stop) {
+        [fetch.data appendBytes:bytes length:byteRange.length];
+    }];
+}
+
+// sent before didCompleteWithError. A revalidated response is a network load answered with 304.
+- (void)URLSession:(NSURLSession *)session task:(NSURLSessionTask *)task didFinishCollectingMetrics:(NSURLSessionTaskMetrics *)metrics API_AVAILABLE(ios(10.0)) {
+    NSURLSessionTaskTransactionMetrics *transaction = metrics.transactionMetrics.lastObject;
+    if (transaction == nil) {
+        return;
+    }
+    NSString *cacheUse = fluwxStatHttpCacheMisses;
+    if (transaction.resourceFetchType == NSURLSessionTaskMetricsResourceFetchTypeLocalCache) {
+        cacheUse = fluwxStatHttpCacheHits;
+    } else if ([transaction.response isKindOfClass:[NSHTTPURLResponse class]] && ((NSHTTPURLResponse *) transaction.response).statusCode == 304) {
+        cacheUse = fluwxStatHttpCacheRevalidations;
+    }
+    [self fetchOfTask:task].cacheUse = cacheUse;
+}
+
+- (void)URLSession:(NSURLSession *)session task:(NSURLSessionTask *)task didCompleteWithError:(NSError *)error {
+    FluwxFetch *fetch;
+    @synchronized (self) {
+        fetch = _fetches[@(task.taskIdentifier)];
+        [_fetches removeObjectForKey:@(task.taskIdentifier)];
+    }
+    if (fetch == nil) {
+        // a warming request.
+        return;
+    }
+    fetch.error = error;
+    dispatch_semaphore_signal(fetch.done);
+}
+
+@end
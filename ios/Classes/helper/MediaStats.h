@@ -0,0 +1,53 @@
+//
+// Counters of the media pipeline since the app started, returned to Dart by getMediaStats.
+// Android keeps the same keys in MediaStats.java.
+//
+
+#import <Foundation/Foundation.h>
+
+// thumbnails and transcodes fitted into a byte budget by ThumbnailHelper, the encodes they took,
+// how many needed the forced downscale after two encodes missed, and how many were dropped because even
+// that was over the budget.
+extern NSString *const fluwxStatSolverRuns;
+extern NSString *const fluwxStatSolverEncodes;
+extern NSString *const fluwxStatSolverForcedDownscales;
+extern NSString *const fluwxStatSolverMisses;
+
+// thumbnails sent without decoding: the source's own bytes, or the thumbnail embedded in its EXIF.
+extern NSString *const fluwxStatThumbnailPassthroughs;
+extern NSString *const fluwxStatThumbnailEmbedded;
+
+// a thumbnail was reused because another source had the same bytes.
+extern NSString *const fluwxStatThumbnailDedupHits;
+extern NSString *const fluwxStatThumbnailDedupMisses;
+
+// a download was served by the HTTP cache, revalidated with a 304, or went to the network;
+// bytes of bodies served from the cache.
+extern NSString *const fluwxStatHttpCacheHits;
+extern NSString *const fluwxStatHttpCacheRevalidations;
+extern NSString *const fluwxStatHttpCacheMisses;
+extern NSString *const fluwxStatHttpCacheBytesSaved;
+
+// a download was abandoned because its body was longer than the cap of what it was for.
+extern NSString *const fluwxStatFetchesAborted;
+
+// media hosts passed to registerApp that a connection was set up to in advance.
+extern NSString *const fluwxStatMediaHostsWarmed;
+
+// milliseconds the first share with media since launch took to prepare, once for a share that started after
+// media hosts had been warmed and once for one that started before any was; 0 until there is such a share.
+extern NSString *const fluwxStatFirstWarmShareMillis;
+extern NSString *const fluwxStatFirstColdShareMillis;
+
+@interface MediaStats : NSObject
++ (void)increment:(NSString *)stat;
+
++ (void)add:(long long)count to:(NSString *)stat;
+
++ (long long)valueOf:(NSString *)stat;
+
+// keeps the latency of the first warm and the first cold share only; later calls are ignored.
++ (void)recordFirstShare:(long long)millis prewarmed:(BOOL)prewarmed;
+
++ (NSDictionary<NSString *, NSNumber *> *)snapshot;
+@end
@@ -0,0 +1,91 @@
+//
+// Counters of the media pipeline, see MediaStats.h.
+//
+
+#import "MediaStats.h"
+
+NSString *const fluwxStatSolverRuns = @"solverRuns";
+NSString *const fluwxStatSolverEncodes = @"solverEncodes";
+NSString *const fluwxStatSolverForcedDownscales = @"solverForcedDownscales";
+NSString *const fluwxStatSolverMisses = @"solverMisses";
+NSString *const fluwxStatThumbnailPassthroughs = @"thumbnailPassthroughs";
+NSString *const fluwxStatThumbnailEmbedded = @"thumbnailEmbedded";
+NSString *const fluwxStatThumbnailDedupHits = @"thumbnailDedupHits";
+NSString *const fluwxStatThumbnailDedupMisses = @"thumbnailDedupMisses";
+NSString *const fluwxStatHttpCacheHits = @"httpCacheHits";
+NSString *const fluwxStatHttpCacheRevalidations = @"httpCacheRevalidations";
+NSString *const fluwxStatHttpCacheMisses = @"httpCacheMisses";
+NSString *const fluwxStatHttpCacheBytesSaved = @"httpCacheBytesSaved";
+NSString *const fluwxStatFetchesAborted = @"fetchesAborted";
+NSString *const fluwxStatMediaHostsWarmed = @"mediaHostsWarmed";
+NSString *const fluwxStatFirstWarmShareMillis = @"firstWarmShareMillis";
+NSString *const fluwxStatFirstColdShareMillis = @"firstColdShareMillis";
+
+@implementation MediaStats
+
++ (NSMutableDictionary<NSString *, NSNumber *> *)counters {
+    static NSMutableDictionary *counters;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        counters = [@{
+                fluwxStatSolverRuns: @0,
+                fluwxStatSolverEncodes: @0,
+                fluwxStatSolverForcedDownscales: @0,
+                fluwxStatSolverMisses: @0,
+                fluwxStatThumbnailPassthroughs: @0,
+                fluwxStatThumbnailEmbedded: @0,
+                fluwxStatThumbnailDedupHits: @0,
+                fluwxStatThumbnailDedupMisses: @0,
+                fluwxStatHttpCacheHits: @0,
+                fluwxStatHttpCacheRevalidations: @0,
+                fluwxStatHttpCacheMisses: @0,
+                fluwxStatHttpCacheBytesSaved: @0,
+                fluwxStatFetchesAborted: @0,
+                fluwxStatMediaHostsWarmed: @0,
+                fluwxStatFirstWarmShareMillis: @0,
+                fluwxStatFirstColdShareMillis: @0,
+        } mutableCopy];
+    });
+    return counters;
+}
+
++ (void)increment:(NSString *)stat {
+    [self add:1 to:stat];
+}
+
++ (void)add:(long long)count to:(NSString *)stat {
+    NSMutableDictionary *counters = [self counters];
+    @synchronized (counters) {
+        counters[stat] = @([counters[stat] longLongValue] + count);
+    }
+}
+
++ (long long)valueOf:(NSString *)stat {
+    NSMutableDictionary *counters = [self counters];
+    @synchronized (counters) {
+        return [counters[stat] longLongValue];
+    }
+}
+
++ (void)recordFirstShare:(long long)millis prewarmed:(BOOL)prewarmed {
+    static BOOL warmRecorded;
+    static BOOL coldRecorded;
+    NSMutableDictionary *counters = [self counters];
+    @synchronized (counters) {
+        BOOL *recorded = prewarmed ? &warmRecorded : &coldRecorded;
+        if (*recorded) {
+            return;
+        }
+        *recorded = YES;
+        counters[prewarmed ? fluwxStatFirstWarmShareMillis : fluwxStatFirstColdShareMillis] = @(millis);
+    }
+}
+
++ (NSDictionary<NSString *, NSNumber *> *)snapshot {
+    NSMutableDictionary *counters = [self counters];
+    @synchronized (counters) {
+        return [counters copy];
+    }
+}
+
+@end
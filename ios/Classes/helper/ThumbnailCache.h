@@ -0,0 +1,41 @@
+//
+// Encoded thumbnails, keyed by image and byte budget: an NSCache in front of a bounded directory
+// in Caches. Mirrors ThumbnailCache.java.
+//
+
+#import <Foundation/Foundation.h>
+
+
+@interface ThumbnailCacheEntry : NSObject
+// changes whenever the image does: size and modification date of a file, ETag of a URL. May be nil.
+@property(nonatomic, copy, readonly) NSString *validator;
+// until then the entry may be used without checking validator.
+@property(nonatomic, strong, readonly) NSDate *expiresAt;
+@property(nonatomic, strong, readonly) NSData *data;
+@end
+
+
+@interface ThumbnailCache : NSObject
++ (instancetype)sharedCache;
+
+// embedded: the thumbnail may be the image's EXIF one, which differs from the one decoded at the same size,
+// so the two are kept apart.
++ (NSString *)keyForImage:(NSString *)imageKey size:(NSUInteger)size embedded:(BOOL)embedded;
+
+// key of a thumbnail of exactly these bytes, whichever URL they came from. Such entries never go stale.
++ (NSString *)keyForContent:(NSData *)data size:(NSUInteger)size embedded:(BOOL)embedded;
+
+// validator of a local file, nil if it doesn't exist.
++ (NSString *)validatorOfFileAtPath:(NSString *)path;
+
+// ETag of response, the validator of a URL. nil if there is none.
++ (NSString *)ETagOfResponse:(NSHTTPURLResponse *)response;
+
+// until when response may be used without revalidating, from its Cache-Control max-age. Never nil.
++ (NSDate *)expiryOfResponse:(NSHTTPURLResponse *)response;
+
+// nil if nothing is cached for key. Validating the entry is up to the caller.
+- (ThumbnailCacheEntry *)entryForKey:(NSString *)key;
+
+- (void)storeData:(NSData *)data forKey:(NSString *)key validator:(NSString *)validator expiresAt:(NSDate *)expiresAt;
+@end
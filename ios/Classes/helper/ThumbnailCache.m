@@ -0,0 +1,212 @@
+//
+// Encoded thumbnails, see ThumbnailCache.h.
+//
+
+#import "ThumbnailCache.h"
+#import <CommonCrypto/CommonDigest.h>
+
+static NSString *const directoryName = @"fluwx_thumbnails";
+static const NSUInteger memoryCacheSize = 4 * 1024 * 1024;
+static const unsigned long long diskCacheSize = 20 * 1024 * 1024;
+
+static NSString *const entryKey = @"key";
+static NSString *const entryValidator = @"validator";
+static NSString *const entryExpiresAt = @"expiresAt";
+static NSString *const entryData = @"data";
+
+
+@interface ThumbnailCacheEntry ()
+@property(nonatomic, copy, readwrite) NSString *validator;
+@property(nonatomic, strong, readwrite) NSDate *expiresAt;
+@property(nonatomic, strong, readwrite) NSData *data;
+@end
+
+@implementation ThumbnailCacheEntry
+@end
+
+
+@implementation ThumbnailCache {
+    NSCache *_memoryCache;
+    NSString *_directory;
+    // serializes disk access
+    dispatch_queue_t _diskQueue;
+}
+
++ (instancetype)sharedCache {
+    static ThumbnailCache *sharedCache;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedCache = [[ThumbnailCache alloc] init];
+    });
+    return sharedCache;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _memoryCache = [[NSCache alloc] init];
+        _memoryCache.totalCostLimit = memoryCacheSize;
+        NSString *caches = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES).firstObject;
+        _directory = [caches stringByAppendingPathComponent:directoryName];
+        _diskQueue = dispatch_queue_create("com.jarvanmo.fluwx.thumbnailCache", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
++ (NSString *)keyForImage:(NSString *)imageKey size:(NSUInteger)size embedded:(BOOL)embedded {
+    return [NSString stringWithFormat:@"%@@%lu/%@", imageKey, (unsigned long) size, embedded ? @"embedded" : @"decoded"];
+}
+
++ (NSString *)keyForContent:(NSData *)data size:(NSUInteger)size embedded:(BOOL)embedded {
+    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256(data.bytes, (CC_LONG) data.length, digest);
+    NSMutableString *hash = [NSMutableString stringWithString:@"sha256:"];
+    for (int i = 0; i < CC_SHA256_DIGEST_LENGTH; i++) {
+        [hash appendFormat:@"%02x", digest[i]];
+    }
+    return [self keyForImage:hash size:size embedded:embedded];
+}
+
++ (NSString *)validatorOfFileAtPath:(NSString *)path {
+    NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:path error:nil];
+    if (attributes == nil) {
+        return nil;
+    }
+    return [NSString stringWithFormat:@"%llu@%.3f", [attributes fileSize], [[attributes fileModificationDate] timeIntervalSince1970]];
+}
+
+// header names are case-insensitive, allHeaderFields doesn't look them up that way on every iOS version.
++ (NSString *)valueOfHeader:(NSString *)name inResponse:(NSHTTPURLResponse *)response {
+    for (NSString *field in response.allHeaderFields) {
+        if ([field caseInsensitiveCompare:name] == NSOrderedSame) {
+            return response.allHeaderFields[field];
+        }
+    }
+    return nil;
+}
+
++ (NSString *)ETagOfResponse:(NSHTTPURLResponse *)response {
+    return [self valueOfHeader:@"ETag" inResponse:response];
+}
+
++ (NSDate *)expiryOfResponse:(NSHTTPURLResponse *)response {
+    NSString *cacheControl = [self valueOfHeader:@"Cache-Control" inResponse:response];
+    for (NSString *directive in [cacheControl componentsSeparatedByString:@","]) {
+        NSString *trimmed = [directive stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+        if ([trimmed hasPrefix:@"no-cache"] || [trimmed hasPrefix:@"no-store"]) {
+            return [NSDate distantPast];
+        }
+        if ([trimmed hasPrefix:@"max-age="]) {
+            NSInteger maxAge = [[trimmed substringFromIndex:@"max-age=".length] integerValue];
+            if (maxAge > 0) {
+                return [NSDate dateWithTimeIntervalSinceNow:maxAge];
+            }
+        }
+    }
+    return [NSDate distantPast];
+}
+
+- (ThumbnailCacheEntry *)entryForKey:(NSString *)key {
+    ThumbnailCacheEntry *entry = [_memoryCache objectForKey:key];
+    if (entry != nil) {
+        return entry;
+    }
+
+    NSString *path = [self pathForKey:key];
+    __block NSDictionary *stored = nil;
+    dispatch_sync(_diskQueue, ^{
+        NSData *plist = [NSData dataWithContentsOfFile:path];
+        if (plist == nil) {
+            return;
+        }
+        stored = [NSPropertyListSerialization propertyListWithData:plist options:NSPropertyListImmutable format:NULL error:nil];
+        // least recently used goes first when trimming.
+        [[NSFileManager defaultManager] setAttributes:@{NSFileModificationDate: [NSDate date]} ofItemAtPath:path error:nil];
+    });
+    if (![stored isKindOfClass:[NSDictionary class]] || ![stored[entryKey] isEqual:key] || ![stored[entryData] isKindOfClass:[NSData class]]) {
+        return nil;
+    }
+
+    entry = [[ThumbnailCacheEntry alloc] init];
+    entry.validator = stored[entryValidator];
+    entry.expiresAt = stored[entryExpiresAt];
+    entry.data = stored[entryData];
+    [_memoryCache setObject:entry forKey:key cost:entry.data.length];
+    return entry;
+}
+
+- (void)storeData:(NSData *)data forKey:(NSString *)key validator:(NSString *)validator expiresAt:(NSDate *)expiresAt {
+    if (data.length == 0) {
+        return;
+    }
+    ThumbnailCacheEntry *entry = [[ThumbnailCacheEntry alloc] init];
+    entry.validator = validator;
+    entry.expiresAt = expiresAt ?: [NSDate distantPast];
+    entry.data = data;
+    [_memoryCache setObject:entry forKey:key cost:data.length];
+
+    NSMutableDictionary *stored = [@{entryKey: key, entryExpiresAt: entry.expiresAt, entryData: data} mutableCopy];
+    if (validator != nil) {
+        stored[entryValidator] = validator;
+    }
+    NSString *path = [self pathForKey:key];
+    dispatch_async(_diskQueue, ^{
+        NSData *plist = [NSPropertyListSerialization dataWithPropertyList:stored format:NSPropertyListBinaryFormat_v1_0 options:0 error:nil];
+        if (plist == nil) {
+            return;
+        }
+        [[NSFileManager defaultManager] createDirectoryAtPath:self->_directory withIntermediateDirectories:YES attributes:nil error:nil];
+        if ([plist writeToFile:path atomically:YES]) {
+            [self trim];
+        }
+    });
+}
+
+// on _diskQueue
+- (void)trim {
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    NSArray<NSURL *> *files = [fileManager contentsOfDirectoryAtURL:[NSURL fileURLWithPath:_directory]
+                                         includingPropertiesForKeys:@[NSURLFileSizeKey, NSURLContentModificationDateKey]
+                                                            options:NSDirectoryEnumerationSkipsHiddenFiles
+                                                              error:nil];
+    unsigned long long total = 0;
+    for (NSURL *file in files) {
+        NSNumber *size = nil;
+        [file getResourceValue:&size forKey:NSURLFileSizeKey error:nil];
+        total += size.unsignedLongLongValue;
+    }
+    if (total <= diskCacheSize) {
+        return;
+    }
+
+    NSArray<NSURL *> *sorted = [files sortedArrayUsingComparator:^NSComparisonResult(NSURL *url1, NSURL *url2) {
+        NSDate *date1 = nil;
+        NSDate *date2 = nil;
+        [url1 getResourceValue:&date1 forKey:NSURLContentModificationDateKey error:nil];
+        [url2 getResourceValue:&date2 forKey:NSURLContentModificationDateKey error:nil];
+        return [date1 compare:date2];
+    }];
+    for (NSURL *file in sorted) {
+        if (total <= diskCacheSize / 4 * 3) {
+            break;
+        }
+        NSNumber *size = nil;
+        [file getResourceValue:&size forKey:NSURLFileSizeKey error:nil];
+        if ([fileManager removeItemAtURL:file error:nil]) {
+            total -= size.unsignedLongLongValue;
+        }
+    }
+}
+
+- (NSString *)pathForKey:(NSString *)key {
+    NSData *keyData = [key dataUsingEncoding:NSUTF8StringEncoding];
+    unsigned char digest[CC_SHA1_DIGEST_LENGTH];
+    CC_SHA1(keyData.bytes, (CC_LONG) keyData.length, digest);
+    NSMutableString *name = [NSMutableString stringWithCapacity:CC_SHA1_DIGEST_LENGTH * 2];
+    for (int i = 0; i < CC_SHA1_DIGEST_LENGTH; i++) {
+        [name appendFormat:@"%02x", digest[i]];
+    }
+    return [_directory stringByAppendingPathComponent:name];
+}
+
+@end
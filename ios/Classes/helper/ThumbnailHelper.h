@@ -3,8 +3,48 @@
 //
 
 #import <Foundation/Foundation.h>
+#import <UIKit/UIKit.h>
 
 
 @interface ThumbnailHelper : NSObject
-+ (UIImage *)compressImage:(UIImage *)image toByte:(NSUInteger)maxLength isPNG:(BOOL)isPNG;
-@end
\ No newline at end of file
+/**
+ * Fits image into maxLength bytes with the steps of the thumbnail core shared with Android
+ * (fluwx_thumbnail.h), which also does the resampling: one probe encode, then one encode at the predicted
+ * quality and size. Only if that still misses, a third encode of a forced downscale to a size at
+ * which even uncompressed pixels fit; nil if that misses too, WeChat silently rejects a larger image.
+ * encodeCount (may be NULL) receives the number of encodes used; they are counted in MediaStats as well.
+ */
++ (NSData *)compressImage:(UIImage *)image toByte:(NSUInteger)maxLength encodeCount:(NSUInteger *)encodeCount;
+
+/**
+ * Longest edge worth decoding for a thumbnail of maxLength bytes.
+ */
++ (CGFloat)maxPixelSizeForByteBudget:(NSUInteger)maxLength;
+
+/**
+ * Decodes straight to at most maxPixelSize on the longest edge, EXIF orientation applied by ImageIO.
+ * JPEGs are scaled by 1/2, 1/4 or 1/8 while decoding, so the full-size bitmap is never allocated.
+ */
++ (UIImage *)downsampledImageWithData:(NSData *)data maxPixelSize:(CGFloat)maxPixelSize;
++ (UIImage *)downsampledImageWithContentsOfFile:(NSString *)path maxPixelSize:(CGFloat)maxPixelSize;
+
+/**
+ * data itself if it is a JPEG or PNG within maxLength bytes and small enough to be sent as a thumbnail
+ * as is, nil otherwise. Only the header is parsed, nothing is decoded.
+ */
++ (NSData *)passthroughThumbnailOfData:(NSData *)data toByte:(NSUInteger)maxLength;
+
+/**
+ * The JPEG thumbnail embedded in the EXIF of data, upright and within maxLength bytes, or nil if there is
+ * no usable one (too small, letterboxed). Used as is when no rotation is needed, so nothing is decoded.
+ */
++ (NSData *)embeddedThumbnailOfData:(NSData *)data toByte:(NSUInteger)maxLength;
+
+/**
+ * data downscaled and encoded into maxLength bytes, holding at most about memoryBudget bytes of bitmaps
+ * whatever the size of the image: ImageIO decodes it subsampled, straight to the output size, so a
+ * 100 MP panorama is never decoded whole. A JPEG stays a JPEG and a PNG a PNG, opaque or not; any other
+ * image becomes a PNG if it has alpha and a JPEG otherwise.
+ */
++ (NSData *)transcodeImageData:(NSData *)data toByte:(NSUInteger)maxLength memoryBudget:(NSUInteger)memoryBudget;
+@end
@@ -3,56 +3,309 @@
 //
 
 #import "ThumbnailHelper.h"
+#import <ImageIO/ImageIO.h>
+#import "ThumbnailSpec.h"
+#import "fluwx_thumbnail.h"
+#import "ImageHeader.h"
+#import "MediaStats.h"
 
 
 @implementation ThumbnailHelper
 
-+ (UIImage *)compressImage:(UIImage *)image toByte:(NSUInteger)maxLength isPNG:(BOOL) isPNG{
-    // Compress by quality
-    CGFloat compression = 1;
-    NSData *data = UIImageJPEGRepresentation(image, compression);
-    if (data.length < maxLength) return image;
-
-    CGFloat max = 1;
-    CGFloat min = 0;
-    for (int i = 0; i < 6; ++i) {
-        compression = (max + min) / 2;
-        data = UIImageJPEGRepresentation(image, compression);
-        if (data.length < maxLength * 0.9) {
-            min = compression;
-        } else if (data.length > maxLength) {
-            max = compression;
-        } else {
-            break;
++ (NSData *)compressImage:(UIImage *)image toByte:(NSUInteger)maxLength encodeCount:(NSUInteger *)encodeCount {
+    BOOL isPNG = image.CGImage != NULL && [self hasAlpha:image];
+    return [self compressImage:image toByte:maxLength isPNG:isPNG encodeCount:encodeCount];
+}
+
+// isPNG: encode as PNG rather than JPEG, whatever alpha image has.
++ (NSData *)compressImage:(UIImage *)image toByte:(NSUInteger)maxLength isPNG:(BOOL)isPNG encodeCount:(NSUInteger *)encodeCount {
+    NSUInteger count = 0;
+    if (encodeCount) {
+        *encodeCount = 0;
+    }
+    if (image == nil || image.CGImage == NULL) {
+        return nil;
+    }
+
+    fluwx_thumb_format format = isPNG ? FLUWX_THUMB_PNG : FLUWX_THUMB_JPEG;
+    fluwx_image source;
+    if (![self pixelsOfImage:image pixels:&source]) {
+        return nil;
+    }
+
+    // the steps come from the core shared with Android; every one is resampled from source in a single pass.
+    fluwx_thumb_step step;
+    fluwx_thumb_first_step(source.width, source.height, maxLength, format, &step);
+    NSData *data = nil;
+    do {
+        UIImage *working = image;
+        if (step.width != source.width || step.height != source.height || image.imageOrientation != UIImageOrientationUp) {
+            working = [self imageOfPixels:&source resampledToStep:step opaque:!isPNG];
         }
+        data = working == nil ? nil : [self encodeImage:working isPNG:isPNG quality:step.quality / 100.0];
+        count++;
+    } while (data != nil && fluwx_thumb_next_step(source.width, source.height, maxLength, format, &step, data.length));
+    free(source.pixels);
+
+    if (step.index == 3) {
+        [MediaStats increment:fluwxStatSolverForcedDownscales];
+    }
+    [MediaStats increment:fluwxStatSolverRuns];
+    [MediaStats add:(long long) count to:fluwxStatSolverEncodes];
+    if (encodeCount) {
+        *encodeCount = count;
+    }
+    // WeChat silently rejects an image over its budget, so one the forced downscale still misses is dropped.
+    if (data.length > maxLength) {
+        [MediaStats increment:fluwxStatSolverMisses];
+        return nil;
+    }
+    return data;
+}
+
++ (BOOL)hasAlpha:(UIImage *)image {
+    CGImageAlphaInfo alphaInfo = CGImageGetAlphaInfo(image.CGImage);
+    return alphaInfo == kCGImageAlphaFirst || alphaInfo == kCGImageAlphaLast
+            || alphaInfo == kCGImageAlphaPremultipliedFirst || alphaInfo == kCGImageAlphaPremultipliedLast;
+}
+
++ (CGFloat)maxPixelSizeForByteBudget:(NSUInteger)maxLength {
+    return fluwx_thumb_max_pixel_size(maxLength);
+}
+
++ (UIImage *)downsampledImageWithData:(NSData *)data maxPixelSize:(CGFloat)maxPixelSize {
+    if (data.length == 0) {
+        return nil;
+    }
+    CGImageSourceRef source = CGImageSourceCreateWithData((__bridge CFDataRef) data, (__bridge CFDictionaryRef) @{(id) kCGImageSourceShouldCache: @NO});
+    return [self thumbnailFromSource:source maxPixelSize:maxPixelSize];
+}
+
++ (UIImage *)downsampledImageWithContentsOfFile:(NSString *)path maxPixelSize:(CGFloat)maxPixelSize {
+    if (path == nil) {
+        return nil;
+    }
+    CGImageSourceRef source = CGImageSourceCreateWithURL((__bridge CFURLRef) [NSURL fileURLWithPath:path], (__bridge CFDictionaryRef) @{(id) kCGImageSourceShouldCache: @NO});
+    return [self thumbnailFromSource:source maxPixelSize:maxPixelSize];
+}
+
++ (NSData *)passthroughThumbnailOfData:(NSData *)data toByte:(NSUInteger)maxLength {
+    if (data.length == 0 || data.length > maxLength) {
+        return nil;
+    }
+    ImageHeader *header = [ImageHeader headerWithData:data];
+    BOOL passthrough = (header.format == ImageHeaderFormatJPEG || header.format == ImageHeaderFormatPNG)
+            && [header hasSize]
+            && MAX(header.width, header.height) <= fluwxThumbPassthroughMaxEdge
+            && header.orientation == 1;
+    if (!passthrough) {
+        return nil;
+    }
+    [MediaStats increment:fluwxStatThumbnailPassthroughs];
+    return data;
+}
+
++ (NSData *)embeddedThumbnailOfData:(NSData *)data toByte:(NSUInteger)maxLength {
+    ImageHeader *header = [ImageHeader headerWithData:data];
+    if (header.thumbnailRange.location == NSNotFound || ![header hasSize]) {
+        return nil;
+    }
+    NSData *thumbnailData = [data subdataWithRange:header.thumbnailRange];
+    ImageHeader *thumbnailHeader = [ImageHeader headerWithData:thumbnailData];
+    if (![thumbnailHeader hasSize] || MAX(thumbnailHeader.width, thumbnailHeader.height) < fluwxEmbeddedThumbMinEdge) {
+        return nil;
+    }
+    double aspect = (double) header.width / header.height;
+    double thumbnailAspect = (double) thumbnailHeader.width / thumbnailHeader.height;
+    if (fabs(thumbnailAspect / aspect - 1) > fluwxEmbeddedThumbAspectTolerance) {
+        return nil;
+    }
+
+    if (header.orientation == 1 && thumbnailData.length <= maxLength) {
+        [MediaStats increment:fluwxStatThumbnailEmbedded];
+        return thumbnailData;
+    }
+
+    // without FromImageAlways ImageIO returns the embedded thumbnail, rotated by the image's orientation.
+    CGImageSourceRef source = CGImageSourceCreateWithData((__bridge CFDataRef) data, (__bridge CFDictionaryRef) @{(id) kCGImageSourceShouldCache: @NO});
+    if (source == NULL) {
+        return nil;
     }
+    NSDictionary *options = @{
+            (id) kCGImageSourceCreateThumbnailFromImageIfAbsent: @NO,
+            (id) kCGImageSourceCreateThumbnailWithTransform: @YES
+    };
+    CGImageRef imageRef = CGImageSourceCreateThumbnailAtIndex(source, 0, (__bridge CFDictionaryRef) options);
+    CFRelease(source);
+    if (imageRef == NULL) {
+        return nil;
+    }
+    UIImage *image = [UIImage imageWithCGImage:imageRef];
+    CGImageRelease(imageRef);
+    [MediaStats increment:fluwxStatThumbnailEmbedded];
+    return [self compressImage:image toByte:maxLength encodeCount:NULL];
+}
 
-    UIImage *resultImage ;
-    if(isPNG){
-        NSData *tmp = UIImagePNGRepresentation([UIImage imageWithData:data]);
-        resultImage = [UIImage imageWithData:tmp];
++ (NSData *)transcodeImageData:(NSData *)data toByte:(NSUInteger)maxLength memoryBudget:(NSUInteger)memoryBudget {
+    if (data.length == 0) {
+        return nil;
+    }
+    CGImageSourceRef source = CGImageSourceCreateWithData((__bridge CFDataRef) data, (__bridge CFDictionaryRef) @{(id) kCGImageSourceShouldCache: @NO});
+    if (source == NULL) {
+        return nil;
+    }
+    NSDictionary *properties = CFBridgingRelease(CGImageSourceCopyPropertiesAtIndex(source, 0, NULL));
+    double width = [properties[(id) kCGImagePropertyPixelWidth] doubleValue];
+    double height = [properties[(id) kCGImagePropertyPixelHeight] doubleValue];
+    if (width <= 0 || height <= 0) {
+        CFRelease(source);
+        return nil;
+    }
+
+    // as many pixels as fit both the byte budget and a third of the memory budget: the decoded image, the
+    // copy compressImage: resamples from and what is left to the encoder.
+    // a JPEG stays a JPEG and a PNG a PNG, opaque or not; anything else is a PNG only if it has alpha.
+    CFStringRef type = CGImageSourceGetType(source);
+    BOOL isPNG;
+    if (type != NULL && CFStringCompare(type, CFSTR("public.png"), 0) == kCFCompareEqualTo) {
+        isPNG = YES;
+    } else if (type != NULL && CFStringCompare(type, CFSTR("public.jpeg"), 0) == kCFCompareEqualTo) {
+        isPNG = NO;
     } else {
-        resultImage = [UIImage imageWithData:data];
+        isPNG = [properties[(id) kCGImagePropertyHasAlpha] boolValue];
     }
+    double pixelCap = fluwx_thumb_pixel_cap(maxLength, isPNG ? FLUWX_THUMB_PNG : FLUWX_THUMB_JPEG);
+    double pixels = MIN(width * height, MIN(pixelCap, memoryBudget / 3.0 / 4));
+    CGFloat maxPixelSize = floor(MAX(width, height) * sqrt(pixels / (width * height)));
 
+    UIImage *image = [self thumbnailFromSource:source maxPixelSize:MAX(1, maxPixelSize)];
+    return [self compressImage:image toByte:maxLength isPNG:isPNG encodeCount:NULL];
+}
 
-    if (data.length < maxLength) return resultImage;
+// consumes source
++ (UIImage *)thumbnailFromSource:(CGImageSourceRef)source maxPixelSize:(CGFloat)maxPixelSize {
+    if (source == NULL) {
+        return nil;
+    }
+    NSMutableDictionary *options = [@{
+            (id) kCGImageSourceCreateThumbnailFromImageAlways: @YES,
+            (id) kCGImageSourceCreateThumbnailWithTransform: @YES,
+            (id) kCGImageSourceShouldCacheImmediately: @YES,
+            (id) kCGImageSourceThumbnailMaxPixelSize: @(maxPixelSize)
+    } mutableCopy];
+    // weak linked, iOS 9+
+    if (&kCGImageSourceSubsampleFactor != NULL) {
+        NSUInteger subsampleFactor = [self subsampleFactorOfSource:source maxPixelSize:maxPixelSize];
+        if (subsampleFactor > 1) {
+            options[(id) kCGImageSourceSubsampleFactor] = @(subsampleFactor);
+        }
+    }
+    CGImageRef imageRef = CGImageSourceCreateThumbnailAtIndex(source, 0, (__bridge CFDictionaryRef) options);
+    CFRelease(source);
+    if (imageRef == NULL) {
+        return nil;
+    }
+    UIImage *image = [UIImage imageWithCGImage:imageRef];
+    CGImageRelease(imageRef);
+    return image;
+}
 
-    // Compress by size
-    NSUInteger lastDataLength = 0;
-    while (data.length > maxLength && data.length != lastDataLength) {
-        lastDataLength = data.length;
-        CGFloat ratio = (CGFloat)maxLength / data.length;
-        CGSize size = CGSizeMake((NSUInteger)(resultImage.size.width * sqrtf(ratio)),
-                (NSUInteger)(resultImage.size.height * sqrtf(ratio))); // Use NSUInteger to prevent white blank
-        UIGraphicsBeginImageContext(size);
-        [resultImage drawInRect:CGRectMake(0, 0, size.width, size.height)];
-        resultImage = UIGraphicsGetImageFromCurrentImageContext();
-        UIGraphicsEndImageContext();
-        data = UIImageJPEGRepresentation(resultImage, compression);
+// JPEGs can be scaled inside the IDCT by 1/2, 1/4 or 1/8, so a 4000x3000 photo decodes as 500x375
+// instead of at full size. Picks the largest factor that keeps the longest edge at or above maxPixelSize.
++ (NSUInteger)subsampleFactorOfSource:(CGImageSourceRef)source maxPixelSize:(CGFloat)maxPixelSize {
+    CFStringRef type = CGImageSourceGetType(source);
+    if (type == NULL || CFStringCompare(type, CFSTR("public.jpeg"), 0) != kCFCompareEqualTo) {
+        return 1;
+    }
+    NSDictionary *properties = CFBridgingRelease(CGImageSourceCopyPropertiesAtIndex(source, 0, NULL));
+    CGFloat longest = MAX([properties[(id) kCGImagePropertyPixelWidth] doubleValue], [properties[(id) kCGImagePropertyPixelHeight] doubleValue]);
+    NSUInteger factor = 1;
+    while (factor < 8 && longest / (factor * 2) >= maxPixelSize) {
+        factor *= 2;
     }
+    return factor;
+}
+
+// oriented size in pixels
++ (CGSize)pixelSizeOfImage:(UIImage *)image {
+    return CGSizeMake(image.size.width * image.scale, image.size.height * image.scale);
+}
 
-    return resultImage;
++ (NSData *)encodeImage:(UIImage *)image isPNG:(BOOL)isPNG quality:(CGFloat)quality {
+    return isPNG ? UIImagePNGRepresentation(image) : UIImageJPEGRepresentation(image, quality);
+}
+
++ (CGBitmapInfo)bitmapInfoOpaque:(BOOL)opaque {
+    return (CGBitmapInfo) (opaque ? kCGImageAlphaNoneSkipFirst : kCGImageAlphaPremultipliedFirst) | kCGBitmapByteOrder32Little;
+}
+
+// image drawn upright into premultiplied 32-bit pixels, the layout the core resamples; the caller frees pixels.
+// Opaque images get an alpha of 255 too, which keeps the core's Lanczos clamp harmless for them.
++ (BOOL)pixelsOfImage:(UIImage *)image pixels:(fluwx_image *)pixels {
+    CGSize pixelSize = [self pixelSizeOfImage:image];
+    size_t width = MAX(1, (size_t) round(pixelSize.width));
+    size_t height = MAX(1, (size_t) round(pixelSize.height));
+    void *data = calloc(height, width * 4);
+    if (data == NULL) {
+        return NO;
+    }
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGContextRef context = CGBitmapContextCreate(data, width, height, 8, width * 4, colorSpace, [self bitmapInfoOpaque:NO]);
+    CGColorSpaceRelease(colorSpace);
+    if (context == NULL) {
+        free(data);
+        return NO;
+    }
+    if (image.imageOrientation == UIImageOrientationUp) {
+        CGContextDrawImage(context, CGRectMake(0, 0, width, height), image.CGImage);
+    } else {
+        // UIKit applies the orientation, in its top-down coordinates.
+        CGContextTranslateCTM(context, 0, height);
+        CGContextScaleCTM(context, 1, -1);
+        UIGraphicsPushContext(context);
+        [image drawInRect:CGRectMake(0, 0, width, height)];
+        UIGraphicsPopContext();
+    }
+    CGContextRelease(context);
+
+    pixels->pixels = data;
+    pixels->width = (int32_t) width;
+    pixels->height = (int32_t) height;
+    pixels->stride = width * 4;
+    pixels->format = FLUWX_PIXEL_RGBA_8888;
+    return YES;
+}
+
+// source resampled to the size of step by the core's Lanczos3 filter, as an image of its own.
++ (UIImage *)imageOfPixels:(const fluwx_image *)source resampledToStep:(fluwx_thumb_step)step opaque:(BOOL)opaque {
+    NSData *data;
+    if (step.width == source->width && step.height == source->height) {
+        data = [NSData dataWithBytes:source->pixels length:source->stride * source->height];
+    } else {
+        fluwx_image scaled = {NULL, step.width, step.height, (size_t) step.width * 4, FLUWX_PIXEL_RGBA_8888};
+        scaled.pixels = malloc(scaled.stride * scaled.height);
+        if (scaled.pixels == NULL) {
+            return nil;
+        }
+        if (fluwx_resample(source, &scaled, FLUWX_FILTER_LANCZOS3) != FLUWX_OK) {
+            free(scaled.pixels);
+            return nil;
+        }
+        data = [NSData dataWithBytesNoCopy:scaled.pixels length:scaled.stride * scaled.height freeWhenDone:YES];
+    }
+
+    CGDataProviderRef provider = CGDataProviderCreateWithCFData((__bridge CFDataRef) data);
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGImageRef imageRef = CGImageCreate((size_t) step.width, (size_t) step.height, 8, 32, (size_t) step.width * 4, colorSpace,
+            [self bitmapInfoOpaque:opaque], provider, NULL, false, kCGRenderingIntentDefault);
+    CGColorSpaceRelease(colorSpace);
+    CGDataProviderRelease(provider);
+    if (imageRef == NULL) {
+        return nil;
+    }
+    UIImage *image = [UIImage imageWithCGImage:imageRef];
+    CGImageRelease(imageRef);
+    return image;
 }
 
 
@@ -86,4 +339,4 @@
 
 
 
-@end
\ No newline at end of file
+@end
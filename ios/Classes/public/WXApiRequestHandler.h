@@ -19,7 +19,7 @@
               TagName:(NSString *)tagName
            MessageExt:(NSString *)messageExt
                Action:(NSString *)action
-           ThumbImage:(UIImage *)thumbImage
+            ThumbData:(NSData *)thumbData
               InScene:(enum WXScene)scene
                 title:(NSString *)title
           description:(NSString *)description;
@@ -28,7 +28,7 @@
             TagName:(NSString *)tagName
               Title:(NSString *)title
         Description:(NSString *)description
-         ThumbImage:(UIImage *)thumbImage
+          ThumbData:(NSData *)thumbData
          MessageExt:(NSString *)messageExt
       MessageAction:(NSString *)messageAction
             InScene:(enum WXScene)scene;
@@ -39,7 +39,7 @@
  MusicLowBandDataUrl:(NSString *)musicLowBandDataUrl
                Title:(NSString *)title
          Description:(NSString *)description
-          ThumbImage:(UIImage *)thumbImage
+           ThumbData:(NSData *)thumbData
           MessageExt:(NSString *)messageExt
        MessageAction:(NSString *)messageAction
              TagName:(NSString *)tagName
@@ -49,7 +49,7 @@
      VideoLowBandUrl:(NSString *)videoLowBandUrl
                Title:(NSString *)title
          Description:(NSString *)description
-          ThumbImage:(UIImage *)thumbImage
+           ThumbData:(NSData *)thumbData
           MessageExt:(NSString *)messageExt
        MessageAction:(NSString *)messageAction
              TagName:(NSString *)tagName
@@ -71,7 +71,7 @@
                              path:(NSString *)path
                             title:(NSString *)title
                       Description:(NSString *)description
-                       ThumbImage:(UIImage *)thumbImage
+                        ThumbData:(NSData *)thumbData
                       hdImageData:(NSData *)hdImageData
                   withShareTicket:(BOOL)withShareTicket
                   miniProgramType:(WXMiniProgramType)programType
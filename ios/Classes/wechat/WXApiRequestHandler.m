@@ -30,7 +30,7 @@
               TagName:(NSString *)tagName
            MessageExt:(NSString *)messageExt
                Action:(NSString *)action
-           ThumbImage:(UIImage *)thumbImage
+            ThumbData:(NSData *)thumbData
               InScene:(enum WXScene)scene
                 title:(NSString *)title
           description:(NSString *)description {
@@ -43,7 +43,7 @@
                                                         Object:ext
                                                     MessageExt:(messageExt == (id) [NSNull null]) ? nil : messageExt
                                                  MessageAction:(action == (id) [NSNull null]) ? nil : action
-                                                    ThumbImage:thumbImage
+                                                     ThumbData:thumbData
                                                       MediaTag:(tagName == (id) [NSNull null]) ? nil : tagName];
 
     SendMessageToWXReq *req = [SendMessageToWXReq requestWithText:nil
@@ -58,7 +58,7 @@
             TagName:(NSString *)tagName
               Title:(NSString *)title
         Description:(NSString *)description
-         ThumbImage:(UIImage *)thumbImage
+          ThumbData:(NSData *)thumbData
          MessageExt:(NSString *)messageExt
       MessageAction:(NSString *)messageAction
             InScene:(enum WXScene)scene {
@@ -70,7 +70,7 @@
                                                         Object:ext
                                                     MessageExt:(messageExt == (id) [NSNull null]) ? nil : messageExt
                                                  MessageAction:(messageAction == (id) [NSNull null]) ? nil : messageAction
-                                                    ThumbImage:thumbImage
+                                                     ThumbData:thumbData
                                                       MediaTag:(tagName == (id) [NSNull null]) ? nil : tagName];
 
     SendMessageToWXReq *req = [SendMessageToWXReq requestWithText:nil
@@ -86,7 +86,7 @@
  MusicLowBandDataUrl:(NSString *)musicLowBandDataUrl
                Title:(NSString *)title
          Description:(NSString *)description
-          ThumbImage:(UIImage *)thumbImage
+           ThumbData:(NSData *)thumbData
           MessageExt:(NSString *)messageExt
        MessageAction:(NSString *)messageAction
              TagName:(NSString *)tagName
@@ -107,7 +107,7 @@
                                                         Object:ext
                                                     MessageExt:(messageExt == (id) [NSNull null]) ? nil : messageExt
                                                  MessageAction:(messageAction == (id) [NSNull null]) ? nil : messageAction
-                                                    ThumbImage:thumbImage
+                                                     ThumbData:thumbData
                                                       MediaTag:(tagName == (id) [NSNull null]) ? nil : tagName];
 
     SendMessageToWXReq *req = [SendMessageToWXReq requestWithText:nil
@@ -122,7 +122,7 @@
      VideoLowBandUrl:(NSString *)videoLowBandUrl
                Title:(NSString *)title
          Description:(NSString *)description
-          ThumbImage:(UIImage *)thumbImage
+           ThumbData:(NSData *)thumbData
           MessageExt:(NSString *)messageExt
        MessageAction:(NSString *)messageAction
              TagName:(NSString *)tagName
@@ -133,7 +133,7 @@
     message.messageExt = (messageExt == (id) [NSNull null]) ? nil : messageExt;
     message.messageAction = (messageAction == (id) [NSNull null]) ? nil : messageAction;
     message.mediaTagName = (tagName == (id) [NSNull null]) ? nil : tagName;
-    [message setThumbImage:thumbImage];
+    [message setThumbData:thumbData];
 
     WXVideoObject *ext = [WXVideoObject object];
     if ([StringUtil isBlank:videoURL]) {
@@ -197,7 +197,7 @@
                              path:(NSString *)path
                             title:(NSString *)title
                       Description:(NSString *)description
-                       ThumbImage:(UIImage *)thumbImage
+                        ThumbData:(NSData *)thumbData
                       hdImageData:(NSData *)hdImageData
                   withShareTicket:(BOOL)withShareTicket
                   miniProgramType:(WXMiniProgramType)programType
@@ -229,7 +229,7 @@
                                                         Object:ext
                                                     MessageExt:(messageExt == (id) [NSNull null]) ? nil : messageExt
                                                  MessageAction:(messageAction == (id) [NSNull null]) ? nil : messageAction
-                                                    ThumbImage:thumbImage
+                                                     ThumbData:thumbData
                                                       MediaTag:(tagName == (id) [NSNull null]) ? nil : tagName];
 
     SendMessageToWXReq *req = [SendMessageToWXReq requestWithText:nil
@@ -17,4 +17,12 @@
                        MessageAction:(NSString *)action
                           ThumbImage:(UIImage *)thumbImage
                             MediaTag:(NSString *)tagName;
+
++ (WXMediaMessage *)messageWithTitle:(NSString *)title
+                         Description:(NSString *)description
+                              Object:(id)mediaObject
+                          MessageExt:(NSString *)messageExt
+                       MessageAction:(NSString *)action
+                           ThumbData:(NSData *)thumbData
+                            MediaTag:(NSString *)tagName;
 @end
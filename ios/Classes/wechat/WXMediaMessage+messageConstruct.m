@@ -28,4 +28,22 @@
     return message;
 }
 
++ (WXMediaMessage *)messageWithTitle:(NSString *)title
+                         Description:(NSString *)description
+                              Object:(id)mediaObject
+                          MessageExt:(NSString *)messageExt
+                       MessageAction:(NSString *)action
+                           ThumbData:(NSData *)thumbData
+                            MediaTag:(NSString *)tagName {
+    WXMediaMessage *message = [WXMediaMessage message];
+    message.title = title;
+    message.description = description;
+    message.mediaObject = mediaObject;
+    message.messageExt = messageExt;
+    message.messageAction = action;
+    message.mediaTagName = tagName;
+    message.thumbData = thumbData;
+    return message;
+}
+
 @end
@@ -111,16 +111,22 @@ Future<dynamic> _handler(MethodCall methodCall) {
 ///[appId] is not necessary.
 ///if [doOnIOS] is true ,fluwx will register WXApi on iOS.
 ///if [doOnAndroid] is true, fluwx will register WXApi on Android.
+///[mediaHosts] are hosts share media is downloaded from, such as
+///`cdn.example.com` or `https://cdn.example.com:8443`. Connections to them
+///are set up in the background, so the first share doesn't wait for DNS,
+///TCP and TLS. Unused connections are closed after a few idle minutes.
 Future register(
     {String appId,
     bool doOnIOS: true,
     doOnAndroid: true,
-    enableMTA: false}) async {
+    enableMTA: false,
+    List<String> mediaHosts}) async {
   return await _channel.invokeMethod("registerApp", {
     "appId": appId,
     "iOS": doOnIOS,
     "android": doOnAndroid,
-    "enableMTA": enableMTA
+    "enableMTA": enableMTA,
+    "mediaHosts": mediaHosts
   });
 }
 
@@ -167,15 +173,66 @@ void dispose({
 ///[WeChatShareVideoModel]
 ///[WeChatShareMusicModel]
 ///[WeChatShareImageModel]
+///
+/// Throws [WeChatMediaTooLargeException] if a remote image or thumbnail is
+/// longer than the plugin downloads for it.
 Future share(WeChatShareModel model) async {
   if (_shareModelMethodMapper.containsKey(model.runtimeType)) {
-    return await _channel.invokeMethod(
+    return await _invokeShare(
         _shareModelMethodMapper[model.runtimeType], model.toMap());
   } else {
     return Future.error("no method mapper found[${model.runtimeType}]");
   }
 }
 
+/// Downloads, decodes and compresses the media of [model] in the background
+/// and keeps it on the native side, so that [sharePrepared] only has to build
+/// and send the message. Useful to share one item to several scenes, or to
+/// start the work while a share sheet is shown.
+/// The prepared media is dropped after [ttl] or by [releasePreparedShare].
+/// Throws [WeChatMediaTooLargeException] like [share].
+Future<WeChatPreparedShare> prepareShare(WeChatShareModel model,
+    {Duration ttl = const Duration(minutes: 5)}) async {
+  if (!_shareModelMethodMapper.containsKey(model.runtimeType)) {
+    return Future.error("no method mapper found[${model.runtimeType}]");
+  }
+  final String id = await _invokeShare("prepareShare", {
+    "method": _shareModelMethodMapper[model.runtimeType],
+    "model": model.toMap(),
+    "ttl": ttl.inMilliseconds
+  });
+  return WeChatPreparedShare(id);
+}
+
+/// Shares what [prepareShare] has prepared. [scene] overrides the scene of
+/// the prepared model. Fails with `prepared share not found` once the handle
+/// has been released or has expired.
+Future sharePrepared(WeChatPreparedShare preparedShare,
+    {WeChatScene scene}) async {
+  return await _channel.invokeMethod("sharePrepared",
+      {"id": preparedShare.id, "scene": scene?.toString()});
+}
+
+/// invokes a method that downloads share media, turning the error of a
+/// download over its cap into a [WeChatMediaTooLargeException].
+Future _invokeShare(String method, dynamic arguments) async {
+  try {
+    return await _channel.invokeMethod(method, arguments);
+  } on PlatformException catch (e) {
+    if (e.code == "media too large" && e.details is Map) {
+      throw WeChatMediaTooLargeException(
+          e.details["url"], (e.details["limit"] as num)?.toInt());
+    }
+    rethrow;
+  }
+}
+
+/// Drops the media kept for [preparedShare]. Returns false if it was already gone.
+Future<bool> releasePreparedShare(WeChatPreparedShare preparedShare) async {
+  return await _channel
+      .invokeMethod("releasePreparedShare", {"id": preparedShare.id});
+}
+
 /// The WeChat-Login is under Auth-2.0
 /// This method login with native WeChat app.
 /// For users without WeChat app, please use [authByQRCode] instead
@@ -306,6 +363,30 @@ Future<bool> openWeChatApp() async {
   return await _channel.invokeMethod("openWXApp");
 }
 
+/// counters of the native media pipeline since the app started, such as
+/// `thumbnailDedupHits` and `thumbnailDedupMisses`. `solverEncodes` divided
+/// by `solverRuns` is the number of encodes per thumbnail, at most two unless
+/// `solverForcedDownscales` counts a third, and `solverMisses` counts
+/// thumbnails dropped because even that was over budget; `thumbnailPassthroughs` and
+/// `thumbnailEmbedded` are thumbnails that needed no encode at all. On Android, `bytesCopied`
+/// and `bitmapBytesAllocated` divided by `mediaShares` are the bytes copied and
+/// the bitmap bytes allocated per share, and `bitmapPoolHits` against
+/// `bitmapPoolMisses` is the hit rate of the bitmap pool.
+/// `httpCacheHits`, `httpCacheRevalidations`, `httpCacheMisses` and
+/// `httpCacheBytesSaved` tell how the HTTP cache of downloaded media served them.
+/// `fetchesAborted` counts downloads abandoned for being longer than their cap.
+/// `mediaHostsWarmed` counts the `mediaHosts` of [register] connected to in
+/// advance. `firstWarmShareMillis` is how long the first share with media took
+/// to prepare if it started after hosts had been warmed, `firstColdShareMillis`
+/// if it started before any was; each is 0 until there is such a share. A warm
+/// share after a cold one may reuse its connections, so compare launches with
+/// and without `mediaHosts`.
+/// They are meant for diagnostics, keys may differ between platforms.
+Future<Map<String, int>> getMediaStats() async {
+  final Map stats = await _channel.invokeMethod("getMediaStats");
+  return Map<String, int>.from(stats);
+}
+
 _handleOnAuthByQRCodeFinished(MethodCall methodCall) {
   int errCode = methodCall.arguments["errCode"];
   _authByQRCodeFinishedController.add(AuthByQRCodeResult(
@@ -363,3 +363,29 @@ class WeChatShareWebPageModel extends WeChatShareModel {
     };
   }
 }
+
+/// Handle of a share whose media has been prepared by `prepareShare`.
+/// Send it with `sharePrepared`, as often and to as many scenes as needed,
+/// until it is released or has expired.
+class WeChatPreparedShare {
+  final String id;
+
+  WeChatPreparedShare(this.id) : assert(id != null);
+}
+
+/// A share failed because a remote image or thumbnail is longer than the
+/// plugin downloads for it. The download was abandoned as soon as that was
+/// known, from its Content-Length or from the bytes received so far.
+class WeChatMediaTooLargeException implements Exception {
+  /// the URL of the media.
+  final String url;
+
+  /// the most bytes downloaded for media of this kind.
+  final int limit;
+
+  WeChatMediaTooLargeException(this.url, this.limit);
+
+  @override
+  String toString() =>
+      "WeChatMediaTooLargeException: $url is longer than $limit bytes";
+}